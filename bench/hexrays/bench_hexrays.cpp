@@ -0,0 +1,512 @@
+/*
+idacpp benchmark: hexrays ctree utilities
+
+Builds synthetic ctrees against the SDK stand-in in ./sdk and measures the
+idacpp::hexrays helpers without a running IDA instance.
+
+Usage: idacpp_bench_hexrays [--quick] [--max-nodes N] [--seed S]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <random>
+#include <string>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/ranges.hpp>
+#include <idacpp/hexrays/scan.hpp>
+
+using namespace idacpp::hexrays;
+
+//--------------------------------------------------------------------------
+// Live heap accounting, used to report bytes per node of each index
+static std::atomic<size_t> g_live_bytes{0};
+static constexpr size_t ALLOC_HDR = 16;
+
+void* operator new(size_t n)
+{
+    auto p = (size_t*)malloc(n + ALLOC_HDR);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    *p = n;
+    g_live_bytes += n;
+    return (char*)p + ALLOC_HDR;
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p == nullptr)
+        return;
+    auto h = (size_t*)((char*)p - ALLOC_HDR);
+    g_live_bytes -= *h;
+    free(h);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+//--------------------------------------------------------------------------
+using bench_clock_t = std::chrono::steady_clock;
+
+static double elapsed_ns(bench_clock_t::time_point start)
+{
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock_t::now() - start).count());
+}
+
+//--------------------------------------------------------------------------
+// Synthetic tree shapes
+enum shape_t
+{
+    SHAPE_RANDOM,   ///< Mixed statements and expressions of random size
+    SHAPE_WIDE,     ///< One huge block of small statements
+    SHAPE_DEEP,     ///< Chains of nested ifs and left-deep expressions
+};
+
+static const char* shape_name(shape_t shape)
+{
+    switch (shape)
+    {
+        case SHAPE_RANDOM: return "random";
+        case SHAPE_WIDE:   return "wide";
+        case SHAPE_DEEP:   return "deep";
+    }
+    return "?";
+}
+
+//--------------------------------------------------------------------------
+/**
+ * Owns every node of a synthetic tree. Stand-in items do not own their
+ * children, so all storage lives in stable-address deques.
+ */
+class tree_builder_t
+{
+    std::deque<cexpr_t> exprs;
+    std::deque<cinsn_t> insns;
+    std::deque<cblock_t> blocks;
+    std::deque<cif_t> ifs;
+    std::deque<cwhile_t> whiles;
+    std::deque<creturn_t> returns;
+    std::deque<cnumber_t> numbers;
+    std::deque<carglist_t> arglists;
+    std::mt19937_64 rng;
+    ea_t next_ea = 0x401000;
+
+public:
+    size_t nodes = 0;
+    cinsnptrvec_t stmts;               ///< Every statement that lives directly in a block
+    std::vector<citem_t*> all_items;   ///< Every node (filled by collect())
+
+    explicit tree_builder_t(uint64_t seed) : rng(seed) {}
+
+    size_t rnd(size_t n) { return size_t(rng() % n); }
+
+    cexpr_t* new_expr(ctype_t op)
+    {
+        auto& e = exprs.emplace_back();
+        e.op = op;
+        e.ea = next_ea++;
+        ++nodes;
+        return &e;
+    }
+
+    cexpr_t* leaf()
+    {
+        switch (rnd(3))
+        {
+            case 0:
+            {
+                auto e = new_expr(cot_num);
+                auto& n = numbers.emplace_back();
+                n._value = rnd(0x1000);
+                e->n = &n;
+                return e;
+            }
+            case 1:
+            {
+                auto e = new_expr(cot_var);
+                e->v.mba = nullptr;
+                e->v.idx = int(rnd(64));
+                return e;
+            }
+            default:
+            {
+                auto e = new_expr(cot_obj);
+                e->obj_ea = 0x500000 + rnd(256) * 16;
+                return e;
+            }
+        }
+    }
+
+    /// Random expression of roughly `budget` nodes
+    cexpr_t* expr(size_t budget)
+    {
+        if (budget <= 1)
+            return leaf();
+
+        size_t kind = rnd(10);
+        if (kind < 6)
+        {
+            static const ctype_t binops[] = { cot_add, cot_sub, cot_mul, cot_band, cot_bor, cot_xor, cot_shl, cot_eq, cot_slt, cot_idx };
+            auto e = new_expr(binops[rnd(qnumber(binops))]);
+            size_t left = 1 + rnd(budget - 1);
+            e->x = expr(left);
+            e->y = expr(budget - left);
+            return e;
+        }
+        if (kind < 8)
+        {
+            static const ctype_t unops[] = { cot_neg, cot_bnot, cot_lnot, cot_cast, cot_ptr, cot_ref };
+            auto e = new_expr(unops[rnd(qnumber(unops))]);
+            e->x = expr(budget - 1);
+            if (e->op == cot_ptr)
+                e->ptrsize = 4;
+            return e;
+        }
+        return call(budget);
+    }
+
+    cexpr_t* call(size_t budget)
+    {
+        auto e = new_expr(cot_call);
+        e->x = leaf();
+        auto& args = arglists.emplace_back();
+        size_t nargs = std::min<size_t>(budget / 2, 1 + rnd(4));
+        args.reserve(nargs);
+        for (size_t i = 0; i < nargs; ++i)
+        {
+            carg_t& a = args.emplace_back();
+            (cexpr_t&)a = *expr(std::max<size_t>(1, budget / (nargs + 1)));
+            a.ea = next_ea++;
+        }
+        e->a = &args;
+        return e;
+    }
+
+    /// Left-deep chain: ((((v + 1) + 2) + 3) ...)
+    cexpr_t* chain(size_t length)
+    {
+        cexpr_t* e = leaf();
+        for (size_t i = 0; i < length; ++i)
+        {
+            auto add = new_expr(cot_add);
+            add->x = e;
+            add->y = leaf();
+            e = add;
+        }
+        return e;
+    }
+
+    cinsn_t* new_block(cinsn_t* ins)
+    {
+        ins->op = cit_block;
+        ins->ea = next_ea++;
+        ins->cblock = &blocks.emplace_back();
+        ++nodes;
+        return ins;
+    }
+
+    cinsn_t& add_stmt(cinsn_t* block)
+    {
+        auto& s = block->cblock->emplace_back();
+        s.ea = next_ea++;
+        ++nodes;
+        stmts.push_back(&s);
+        return s;
+    }
+
+    void expr_stmt(cinsn_t* block, cexpr_t* rhs)
+    {
+        auto& s = add_stmt(block);
+        s.op = cit_expr;
+        auto asg = new_expr(cot_asg);
+        asg->x = leaf();
+        asg->y = rhs;
+        s.cexpr = asg;
+    }
+
+    cinsn_t* sub_block()
+    {
+        return new_block(&insns.emplace_back());
+    }
+
+    /// Fill a block with random statements until `budget` nodes were added
+    void random_block(cinsn_t* block, size_t budget, int depth)
+    {
+        size_t stop = nodes + budget;
+        while (nodes < stop)
+        {
+            size_t left = stop - nodes;
+            size_t kind = depth < 12 ? rnd(10) : 0;
+            if (kind < 6 || left < 16)
+            {
+                expr_stmt(block, expr(std::min<size_t>(left, 1 + rnd(24))));
+            }
+            else if (kind < 8)
+            {
+                auto& s = add_stmt(block);
+                s.op = cit_if;
+                auto& cif = ifs.emplace_back();
+                cif.expr = *expr(1 + rnd(8));
+                cif.ithen = sub_block();
+                random_block(cif.ithen, left / 4, depth + 1);
+                if (rnd(2) != 0)
+                {
+                    cif.ielse = sub_block();
+                    random_block(cif.ielse, left / 8, depth + 1);
+                }
+                s.cif = &cif;
+            }
+            else if (kind < 9)
+            {
+                auto& s = add_stmt(block);
+                s.op = cit_while;
+                auto& w = whiles.emplace_back();
+                w.expr = *expr(1 + rnd(6));
+                w.body = sub_block();
+                random_block(w.body, left / 4, depth + 1);
+                s.cwhile = &w;
+            }
+            else
+            {
+                auto& s = add_stmt(block);
+                s.op = cit_return;
+                auto& r = returns.emplace_back();
+                r.expr = *expr(1 + rnd(4));
+                s.creturn = &r;
+            }
+        }
+    }
+
+    void wide_block(cinsn_t* block, size_t budget)
+    {
+        size_t stop = nodes + budget;
+        while (nodes < stop)
+            expr_stmt(block, expr(3));
+    }
+
+    void deep_block(cinsn_t* block, size_t budget)
+    {
+        static constexpr size_t MAX_NESTING = 1000;
+        size_t stop = nodes + budget;
+        while (nodes < stop)
+        {
+            // A chain of nested ifs, each holding a long expression statement
+            cinsn_t* cur = block;
+            for (size_t level = 0; level < MAX_NESTING && nodes < stop; ++level)
+            {
+                expr_stmt(cur, chain(16));
+                auto& s = add_stmt(cur);
+                s.op = cit_if;
+                auto& cif = ifs.emplace_back();
+                cif.expr = *leaf();
+                cif.ithen = sub_block();
+                s.cif = &cif;
+                cur = cif.ithen;
+            }
+        }
+    }
+
+    void build(cfunc_t* cfunc, shape_t shape, size_t budget)
+    {
+        cfunc->entry_ea = next_ea;
+        new_block(&cfunc->body);
+        switch (shape)
+        {
+            case SHAPE_RANDOM: random_block(&cfunc->body, budget, 0); break;
+            case SHAPE_WIDE:   wide_block(&cfunc->body, budget); break;
+            case SHAPE_DEEP:   deep_block(&cfunc->body, budget); break;
+        }
+
+        all_items.clear();
+        collect(&cfunc->body);
+    }
+
+    void collect(citem_t* root)
+    {
+        std::vector<citem_t*> stack{root};
+        while (!stack.empty())
+        {
+            citem_t* item = stack.back();
+            stack.pop_back();
+            all_items.push_back(item);
+            for_each_child(item, [&stack](citem_t* child) { stack.push_back(child); });
+        }
+    }
+};
+
+//--------------------------------------------------------------------------
+struct bench_row_t
+{
+    size_t nodes;
+    double parents_ns_per_node;
+    double parents_bytes_per_node;
+    double index_ns_per_node;
+    double index_bytes_per_node;
+    double snapshot_ns_per_node;
+    double snapshot_bytes_per_node;
+    double ancestor_ns;
+    double lca_us;
+    double blockpos_ns;
+    double find_expr_mnodes_s;
+    double range_mnodes_s;
+    double scan_mnodes_s;
+};
+
+static bench_row_t run_one(shape_t shape, size_t target, uint64_t seed)
+{
+    bench_row_t row{};
+    cfunc_t cfunc;
+    tree_builder_t tb(seed);
+    tb.build(&cfunc, shape, target);
+    row.nodes = tb.all_items.size();
+    double n = double(row.nodes);
+
+    // Parents-only facet, as used by get_stmt_insn()
+    size_t before = g_live_bytes;
+    auto start = bench_clock_t::now();
+    {
+        ctreeparent_visitor_t parents_only;
+        parents_only.apply_to(&cfunc.body, nullptr);
+        parents_only.ensure(CPF_PARENTS);
+        row.parents_ns_per_node = elapsed_ns(start) / n;
+        row.parents_bytes_per_node = double(g_live_bytes - before) / n;
+    }
+
+    // Every facet the queries below need, built in one pass
+    before = g_live_bytes;
+    start = bench_clock_t::now();
+    auto helper = std::make_unique<ctreeparent_visitor_t>();
+    helper->apply_to(&cfunc.body, nullptr);
+    helper->ensure(CPF_PARENTS | CPF_EA | CPF_INTERVALS | CPF_BLOCKPOS);
+    row.index_ns_per_node = elapsed_ns(start) / n;
+    row.index_bytes_per_node = double(g_live_bytes - before) / n;
+
+    // Snapshot build time and footprint
+    ctree_snapshot_t snap;
+    start = bench_clock_t::now();
+    snap.build(&cfunc);
+    row.snapshot_ns_per_node = elapsed_ns(start) / n;
+    row.snapshot_bytes_per_node = double(snap.memory_bytes()) / n;
+
+    // is_ancestor_of on random pairs
+    std::mt19937_64 rng(seed ^ 0x5EED);
+    static constexpr size_t ANCESTOR_QUERIES = 20000;
+    size_t hits = 0;
+    start = bench_clock_t::now();
+    for (size_t i = 0; i < ANCESTOR_QUERIES; ++i)
+    {
+        auto a = tb.all_items[rng() % tb.all_items.size()];
+        auto b = tb.all_items[rng() % tb.all_items.size()];
+        hits += helper->is_ancestor_of(a, b) ? 1 : 0;
+    }
+    row.ancestor_ns = elapsed_ns(start) / ANCESTOR_QUERIES;
+
+    // keep_lca_cinsns over a random statement sample
+    static constexpr size_t LCA_SAMPLE = 128;
+    cinsnptrvec_t sample;
+    for (size_t i = 0; i < LCA_SAMPLE && !tb.stmts.empty(); ++i)
+        sample.push_back(tb.stmts[rng() % tb.stmts.size()]);
+    start = bench_clock_t::now();
+    keep_lca_cinsns(&cfunc, helper.get(), sample);
+    row.lca_us = elapsed_ns(start) / 1000.0;
+
+    // get_stmt_block_pos for every statement
+    start = bench_clock_t::now();
+    size_t found = 0;
+    for (auto stmt : tb.stmts)
+    {
+        cblock_t* block;
+        cblock_t::iterator pos;
+        found += get_stmt_block_pos(&cfunc, stmt, &block, &pos, helper.get()) ? 1 : 0;
+    }
+    row.blockpos_ns = tb.stmts.empty() ? 0 : elapsed_ns(start) / double(tb.stmts.size());
+
+    // find_expr throughput
+    size_t nums = 0;
+    start = bench_clock_t::now();
+    find_expr(cfuncptr_t(&cfunc), [&nums](cexpr_t* e) -> int
+    {
+        nums += e->op == cot_num ? 1 : 0;
+        return 0;
+    });
+    row.find_expr_mnodes_s = n / (elapsed_ns(start) / 1e9) / 1e6;
+
+    // Same query through the pull-based range
+    size_t nums2 = 0;
+    start = bench_clock_t::now();
+    for (cexpr_t* e : exprs(&cfunc))
+        nums2 += e->op == cot_num ? 1 : 0;
+    row.range_mnodes_s = n / (elapsed_ns(start) / 1e9) / 1e6;
+    if (nums2 != nums)
+        msg("warning: range produced %zu numbers, find_expr %zu\n", nums2, nums);
+
+    // Same query as a vectorized scan of the snapshot op column
+    ctype_set_t num_ops;
+    num_ops.set(cot_num);
+    std::vector<node_id_t> scan_hits;
+    start = bench_clock_t::now();
+    scan_ops(snap, num_ops, scan_hits);
+    row.scan_mnodes_s = n / (elapsed_ns(start) / 1e9) / 1e6;
+    if (scan_hits.size() != nums)
+        msg("warning: scan produced %zu numbers, find_expr %zu\n", scan_hits.size(), nums);
+
+    if (found != tb.stmts.size())
+        msg("warning: %zu/%zu statements without a block position\n", found, tb.stmts.size());
+    (void)hits;
+    return row;
+}
+
+//--------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    size_t max_nodes = 1000000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quick")
+            max_nodes = 10000;
+        else if (arg == "--max-nodes" && i + 1 < argc)
+            max_nodes = size_t(std::strtoull(argv[++i], nullptr, 0));
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 0);
+        else
+        {
+            msg("usage: %s [--quick] [--max-nodes N] [--seed S]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    msg("simd: %s\n", simd_level_name(active_simd_level()));
+    msg("%-7s %9s | %10s %9s | %10s %9s | %10s %9s | %11s %9s %11s | %10s %10s %10s\n",
+        "shape", "nodes",
+        "par ns/n", "par B/n",
+        "index ns/n", "index B/n",
+        "snap ns/n", "snap B/n",
+        "ancestor ns", "lca us", "blkpos ns",
+        "find Mn/s", "range Mn/s", "scan Mn/s");
+
+    for (shape_t shape : { SHAPE_RANDOM, SHAPE_WIDE, SHAPE_DEEP })
+    {
+        for (size_t target = 1000; target <= max_nodes; target *= 10)
+        {
+            auto r = run_one(shape, target, seed);
+            msg("%-7s %9zu | %10.1f %9.1f | %10.1f %9.1f | %10.1f %9.1f | %11.1f %9.1f %11.1f | %10.1f %10.1f %10.1f\n",
+                shape_name(shape), r.nodes,
+                r.parents_ns_per_node, r.parents_bytes_per_node,
+                r.index_ns_per_node, r.index_bytes_per_node,
+                r.snapshot_ns_per_node, r.snapshot_bytes_per_node,
+                r.ancestor_ns, r.lca_us, r.blockpos_ns,
+                r.find_expr_mnodes_s, r.range_mnodes_s, r.scan_mnodes_s);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,445 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Benchmark SDK stand-in - a minimal, working model of the Hex-Rays ctree.
+
+Provides citem_t/cexpr_t/cinsn_t with the same member layout idacpp relies on,
+plus a recursive ctree_visitor_t with CV_PARENTS/CV_POST/CV_PRUNE semantics.
+Items do not own their children: the benchmark's tree builder owns every node.
+*/
+#pragma once
+
+#include "pro.h"
+#include "kernwin.hpp"
+
+enum ctype_t
+{
+    cot_empty = 0, cot_comma, cot_asg, cot_asgbor, cot_asgxor, cot_asgband, cot_asgadd,
+    cot_asgsub, cot_asgmul, cot_asgsshr, cot_asgushr, cot_asgshl, cot_asgsdiv, cot_asgudiv,
+    cot_asgsmod, cot_asgumod, cot_tern, cot_lor, cot_land, cot_bor, cot_xor, cot_band,
+    cot_eq, cot_ne, cot_sge, cot_uge, cot_sle, cot_ule, cot_sgt, cot_ugt, cot_slt, cot_ult,
+    cot_sshr, cot_ushr, cot_shl, cot_add, cot_sub, cot_mul, cot_sdiv, cot_udiv, cot_smod,
+    cot_umod, cot_fadd, cot_fsub, cot_fmul, cot_fdiv, cot_fneg, cot_neg, cot_cast, cot_lnot,
+    cot_bnot, cot_ptr, cot_ref, cot_postinc, cot_postdec, cot_preinc, cot_predec, cot_call,
+    cot_idx, cot_memref, cot_memptr, cot_num, cot_fnum, cot_str, cot_obj, cot_var, cot_insn,
+    cot_sizeof, cot_helper, cot_type,
+    cot_last = cot_type,
+    cit_empty = 70, cit_block, cit_expr, cit_if, cit_for, cit_while, cit_do, cit_switch,
+    cit_break, cit_continue, cit_return, cit_goto, cit_asm, cit_try, cit_throw,
+    cit_end
+};
+
+inline bool op_uses_x(ctype_t op) { return (op >= cot_comma && op <= cot_memptr) || op == cot_sizeof; }
+inline bool op_uses_y(ctype_t op) { return (op >= cot_comma && op <= cot_fdiv) || op == cot_idx; }
+inline bool op_uses_z(ctype_t op) { return op == cot_tern; }
+inline bool is_assignment(ctype_t op) { return op >= cot_asg && op <= cot_asgumod; }
+inline bool is_prepost(ctype_t op) { return op >= cot_postinc && op <= cot_predec; }
+inline bool is_loop(ctype_t op) { return op == cit_for || op == cit_while || op == cit_do; }
+inline const char* get_ctype_name(ctype_t) { return "item"; }
+
+struct cfunc_t;
+struct cinsn_t;
+struct cexpr_t;
+struct mba_t;
+struct carglist_t;
+
+struct tinfo_t
+{
+    size_t get_size() const { return 0; }
+};
+
+struct cnumber_t
+{
+    uint64 _value = 0;
+};
+
+struct fnumber_t
+{
+    uint16 fnum[6];
+    int nbytes;
+};
+
+struct var_ref_t
+{
+    mba_t* mba;
+    int idx;
+};
+
+struct citem_t
+{
+    ea_t ea = BADADDR;
+    ctype_t op = cot_empty;
+    int label_num = -1;
+    mutable int index = -1;
+
+    citem_t() {}
+    explicit citem_t(ctype_t o) : op(o) {}
+    bool is_expr() const { return op <= cot_last; }
+
+    citem_t* find_parent_of(const citem_t* item);
+    const citem_t* find_parent_of(const citem_t* item) const
+    {
+        return const_cast<citem_t*>(this)->find_parent_of(item);
+    }
+};
+
+struct cexpr_t : public citem_t
+{
+    union
+    {
+        cnumber_t* n;
+        fnumber_t* fpc;
+        struct
+        {
+            union
+            {
+                var_ref_t v;
+                ea_t obj_ea;
+            };
+            int refwidth;
+        };
+        struct
+        {
+            cexpr_t* x;
+            union
+            {
+                cexpr_t* y;
+                carglist_t* a;
+                uint32 m;
+            };
+            union
+            {
+                cexpr_t* z;
+                int ptrsize;
+            };
+        };
+        cinsn_t* insn;
+        char* helper;
+        char* string;
+    };
+    tinfo_t type;
+    uint32 exflags = 0;
+
+    cexpr_t() : x(nullptr), y(nullptr), z(nullptr) {}
+    uint64 numval() const { return n->_value; }
+};
+
+struct carg_t : public cexpr_t
+{
+    bool is_vararg = false;
+};
+
+struct carglist_t : public qvector<carg_t>
+{
+    int flags = 0;
+};
+
+struct ceinsn_t
+{
+    cexpr_t expr;
+};
+
+struct cblock_t : public qlist<cinsn_t>
+{
+};
+
+struct cif_t : public ceinsn_t
+{
+    cinsn_t* ithen = nullptr;
+    cinsn_t* ielse = nullptr;
+};
+
+struct cloop_t : public ceinsn_t
+{
+    cinsn_t* body = nullptr;
+};
+
+struct cfor_t : public cloop_t
+{
+    cexpr_t init;
+    cexpr_t step;
+};
+
+struct cwhile_t : public cloop_t {};
+struct cdo_t : public cloop_t {};
+struct creturn_t : public ceinsn_t {};
+
+struct cgoto_t
+{
+    int label_num = -1;
+};
+
+struct casm_t : public eavec_t {};
+
+struct catchexpr_t
+{
+    cexpr_t obj;
+};
+
+struct ccatch_t : public cblock_t
+{
+    qvector<catchexpr_t> exprs;
+};
+
+struct ctry_t : public cblock_t
+{
+    qvector<ccatch_t> catchs;
+};
+
+struct cthrow_t : public ceinsn_t {};
+struct cswitch_t;
+
+struct cinsn_t : public citem_t
+{
+    union
+    {
+        cblock_t* cblock;
+        cexpr_t* cexpr;
+        cif_t* cif;
+        cfor_t* cfor;
+        cwhile_t* cwhile;
+        cdo_t* cdo;
+        cswitch_t* cswitch;
+        creturn_t* creturn;
+        cgoto_t* cgoto;
+        casm_t* casm;
+        ctry_t* ctry;
+        cthrow_t* cthrow;
+    };
+
+    cinsn_t() : cblock(nullptr) {}
+};
+
+struct ccase_t : public cinsn_t
+{
+    uint64vec_t values;
+};
+
+struct ccases_t : public qvector<ccase_t> {};
+
+struct cswitch_t : public ceinsn_t
+{
+    cnumber_t mvnf;
+    ccases_t cases;
+};
+
+typedef qvector<cinsn_t*> cinsnptrvec_t;
+typedef qvector<citem_t*> ctree_items_t;
+
+//--------------------------------------------------------------------------
+// Children of an item, in the order the stand-in visitor walks them
+template <typename F>
+inline void stub_for_each_child(citem_t* item, F&& f)
+{
+    if (item->is_expr())
+    {
+        auto e = (cexpr_t*)item;
+        if (e->op == cot_insn)
+        {
+            f((citem_t*)e->insn);
+            return;
+        }
+        if (op_uses_x(e->op))
+            f((citem_t*)e->x);
+        if (e->op == cot_call)
+        {
+            for (auto& arg : *e->a)
+                f((citem_t*)&arg);
+            return;
+        }
+        if (op_uses_y(e->op))
+            f((citem_t*)e->y);
+        if (op_uses_z(e->op))
+            f((citem_t*)e->z);
+        return;
+    }
+
+    auto ins = (cinsn_t*)item;
+    switch (ins->op)
+    {
+        case cit_block:
+            for (auto& s : *ins->cblock)
+                f((citem_t*)&s);
+            break;
+        case cit_expr:
+            f((citem_t*)ins->cexpr);
+            break;
+        case cit_if:
+            f((citem_t*)&ins->cif->expr);
+            f((citem_t*)ins->cif->ithen);
+            if (ins->cif->ielse != nullptr)
+                f((citem_t*)ins->cif->ielse);
+            break;
+        case cit_for:
+            f((citem_t*)&ins->cfor->init);
+            f((citem_t*)&ins->cfor->expr);
+            f((citem_t*)&ins->cfor->step);
+            f((citem_t*)ins->cfor->body);
+            break;
+        case cit_while:
+            f((citem_t*)&ins->cwhile->expr);
+            f((citem_t*)ins->cwhile->body);
+            break;
+        case cit_do:
+            f((citem_t*)ins->cdo->body);
+            f((citem_t*)&ins->cdo->expr);
+            break;
+        case cit_switch:
+            f((citem_t*)&ins->cswitch->expr);
+            for (auto& c : ins->cswitch->cases)
+                f((citem_t*)&c);
+            break;
+        case cit_return:
+            f((citem_t*)&ins->creturn->expr);
+            break;
+        case cit_try:
+            for (auto& s : *ins->ctry)
+                f((citem_t*)&s);
+            for (auto& c : ins->ctry->catchs)
+            {
+                for (auto& ce : c.exprs)
+                    f((citem_t*)&ce.obj);
+                for (auto& s : c)
+                    f((citem_t*)&s);
+            }
+            break;
+        case cit_throw:
+            f((citem_t*)&ins->cthrow->expr);
+            break;
+        default:
+            break;
+    }
+}
+
+inline citem_t* citem_t::find_parent_of(const citem_t* item)
+{
+    citem_t* found = nullptr;
+    stub_for_each_child(this, [&](citem_t* child)
+    {
+        if (found == nullptr)
+            found = child == item ? this : child->find_parent_of(item);
+    });
+    return found;
+}
+
+//--------------------------------------------------------------------------
+#define CV_FAST    0x0000
+#define CV_PRUNE   0x0001
+#define CV_PARENTS 0x0002
+#define CV_POST    0x0004
+#define CV_RESTART 0x0008
+#define CV_INSNS   0x0010
+
+struct ctree_visitor_t
+{
+    int cv_flags;
+    ctree_items_t parents;
+
+    ctree_visitor_t(int _flags) : cv_flags(_flags) {}
+    virtual ~ctree_visitor_t() {}
+
+    bool maintain_parents() const { return (cv_flags & CV_PARENTS) != 0; }
+    bool must_prune() const { return (cv_flags & CV_PRUNE) != 0; }
+    bool must_restart() const { return (cv_flags & CV_RESTART) != 0; }
+    bool is_postorder() const { return (cv_flags & CV_POST) != 0; }
+    bool only_insns() const { return (cv_flags & CV_INSNS) != 0; }
+    void prune_now() { cv_flags |= CV_PRUNE; }
+    void clr_prune() { cv_flags &= ~CV_PRUNE; }
+    void set_restart() { cv_flags |= CV_RESTART; }
+    void clr_restart() { cv_flags &= ~CV_RESTART; }
+
+    cexpr_t* parent_expr() { return parents.empty() ? nullptr : (cexpr_t*)parents.back(); }
+    cinsn_t* parent_insn() { return parents.empty() ? nullptr : (cinsn_t*)parents.back(); }
+
+    int apply_to(citem_t* item, citem_t* parent)
+    {
+        if (parent != nullptr && maintain_parents())
+            parents.push_back(parent);
+        int code = walk(item);
+        if (parent != nullptr && maintain_parents())
+            parents.pop_back();
+        return code;
+    }
+
+    int apply_to_exprs(citem_t* item, citem_t* parent)
+    {
+        return apply_to(item, parent);
+    }
+
+    virtual int idaapi visit_insn(cinsn_t*) { return 0; }
+    virtual int idaapi visit_expr(cexpr_t*) { return 0; }
+    virtual int idaapi leave_insn(cinsn_t*) { return 0; }
+    virtual int idaapi leave_expr(cexpr_t*) { return 0; }
+
+private:
+    int walk(citem_t* item)
+    {
+        bool is_expr = item->is_expr();
+        if (is_expr && only_insns())
+            return 0;
+
+        int code = is_expr ? visit_expr((cexpr_t*)item) : visit_insn((cinsn_t*)item);
+        if (code != 0)
+            return code;
+        if (must_prune())
+        {
+            clr_prune();
+            return 0;
+        }
+
+        if (maintain_parents())
+            parents.push_back(item);
+        stub_for_each_child(item, [&](citem_t* child)
+        {
+            if (code == 0)
+                code = walk(child);
+        });
+        if (maintain_parents())
+            parents.pop_back();
+        if (code != 0)
+            return code;
+
+        if (is_postorder())
+            code = is_expr ? leave_expr((cexpr_t*)item) : leave_insn((cinsn_t*)item);
+        return code;
+    }
+};
+
+struct ctree_parentee_t : public ctree_visitor_t
+{
+    ctree_parentee_t(bool post = false) : ctree_visitor_t((post ? CV_POST : 0) | CV_PARENTS) {}
+};
+
+//--------------------------------------------------------------------------
+struct lvar_t
+{
+    qstring name;
+};
+struct lvars_t : public qvector<lvar_t> {};
+
+struct cfunc_t
+{
+    ea_t entry_ea = BADADDR;
+    mba_t* mba = nullptr;
+    cinsn_t body;
+    lvars_t lvars;
+    int refcnt = 0;
+
+    lvars_t* get_lvars() { return &lvars; }
+};
+typedef qrefcnt_t<cfunc_t> cfuncptr_t;
+
+enum cursor_item_type_t { VDI_NONE, VDI_EXPR, VDI_LVAR, VDI_FUNC, VDI_TAIL };
+
+struct ctree_item_t
+{
+    cursor_item_type_t citype = VDI_NONE;
+};
+
+struct vdui_t
+{
+    ctree_item_t item;
+};
+
+inline vdui_t* get_widget_vdui(TWidget*) { return nullptr; }
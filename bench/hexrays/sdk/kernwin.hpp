@@ -0,0 +1,58 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Benchmark SDK stand-in - the subset of kernwin.hpp used by idacpp headers.
+UI functions are inert: there is no UI when benchmarking.
+*/
+#pragma once
+
+#include "pro.h"
+
+struct TWidget;
+struct TPopupMenu;
+
+typedef int action_state_t;
+enum
+{
+    AST_ENABLE_ALWAYS,
+    AST_ENABLE_FOR_IDB,
+    AST_ENABLE_FOR_WIDGET,
+    AST_ENABLE,
+    AST_DISABLE_ALWAYS,
+    AST_DISABLE_FOR_IDB,
+    AST_DISABLE_FOR_WIDGET,
+    AST_DISABLE,
+};
+inline bool is_action_enabled(action_state_t s) { return s <= AST_ENABLE; }
+
+struct action_ctx_base_t
+{
+    TWidget* widget = nullptr;
+    ea_t cur_ea = BADADDR;
+};
+typedef action_ctx_base_t action_update_ctx_t;
+typedef action_ctx_base_t action_activation_ctx_t;
+
+struct action_handler_t
+{
+    virtual int idaapi activate(action_activation_ctx_t*) = 0;
+    virtual action_state_t idaapi update(action_update_ctx_t*) = 0;
+    virtual ~action_handler_t() {}
+};
+
+struct action_desc_t
+{
+    const char* name;
+};
+#define ACTION_DESC_LITERAL_PLUGMOD(name, label, handler, owner, shortcut, tooltip, icon) action_desc_t{name}
+
+inline bool register_action(const action_desc_t&) { return false; }
+inline bool unregister_action(const char*) { return false; }
+inline bool attach_action_to_popup(TWidget*, TPopupMenu*, const char*, const char* = nullptr, int = 0) { return false; }
+
+enum { BWN_DISASM = 27, BWN_PSEUDOCODE = 46 };
+inline int get_widget_type(TWidget*) { return -1; }
+inline bool read_range_selection(TWidget*, ea_t*, ea_t*) { return false; }
+inline ea_t get_screen_ea() { return BADADDR; }
+inline ea_t next_head(ea_t, ea_t) { return BADADDR; }
@@ -0,0 +1,116 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Benchmark SDK stand-in - the subset of pro.h used by idacpp headers.
+Not a replacement for the IDA SDK: only enough to build and run benchmarks.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#define idaapi
+#define idaman
+#define ida_export
+#define THREAD_SAFE
+
+typedef unsigned char uchar;
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef uint64 ea_t;
+typedef uint64 uval_t;
+typedef int64 sval_t;
+typedef uint64 asize_t;
+typedef uint32 bgcolor_t;
+typedef uchar color_t;
+
+const ea_t BADADDR = ea_t(-1);
+
+#define qnumber(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+template <class T>
+struct qvector : public std::vector<T>
+{
+    using std::vector<T>::vector;
+    void qclear() { this->clear(); }
+};
+
+template <class T>
+struct qlist : public std::list<T>
+{
+    using std::list<T>::list;
+};
+
+struct qstring : public std::string
+{
+    using std::string::string;
+    qstring() {}
+    qstring(const std::string& s) : std::string(s) {}
+
+    qstring& cat_sprnt(const char* fmt, ...)
+    {
+        char buf[1024];
+        va_list va;
+        va_start(va, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, va);
+        va_end(va);
+        append(buf);
+        return *this;
+    }
+
+    qstring& sprnt(const char* fmt, ...)
+    {
+        char buf[1024];
+        va_list va;
+        va_start(va, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, va);
+        va_end(va);
+        assign(buf);
+        return *this;
+    }
+};
+
+typedef qvector<qstring> qstrvec_t;
+typedef qvector<int> intvec_t;
+typedef qvector<uint64> uint64vec_t;
+typedef qvector<ea_t> eavec_t;
+
+template <class T>
+class qrefcnt_t
+{
+    T* ptr = nullptr;
+
+public:
+    qrefcnt_t() {}
+    explicit qrefcnt_t(T* p) : ptr(p) {}
+    T* operator->() const { return ptr; }
+    T& operator*() const { return *ptr; }
+    operator T*() const { return ptr; }
+    void reset() { ptr = nullptr; }
+};
+
+inline bool streq(const char* a, const char* b) { return strcmp(a, b) == 0; }
+
+inline void msg(const char* fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    vprintf(fmt, va);
+    va_end(va);
+}
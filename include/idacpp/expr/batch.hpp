@@ -0,0 +1,203 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Expression utilities module - Batch evaluation
+*/
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <expr.hpp>
+
+#include <idacpp/expr/cache.hpp>
+
+namespace idacpp::expr
+{
+
+namespace batch_detail
+{
+    template <typename T, typename = void>
+    struct is_tuple_like : std::false_type {};
+
+    template <typename T>
+    struct is_tuple_like<T, std::void_t<decltype(std::tuple_size<T>::value)>> : std::true_type {};
+
+    template <typename T>
+    size_t arity()
+    {
+        if constexpr (is_tuple_like<T>::value)
+            return std::tuple_size<T>::value;
+        else
+            return 1;
+    }
+
+    /// Store a value into an existing idc_value_t
+    template <typename T>
+    void set_arg(idc_value_t& v, const T& x)
+    {
+        if constexpr (std::is_same_v<T, idc_value_t>)
+            v = x;
+        else if constexpr (std::is_same_v<T, qstring>)
+            v.set_string(x.c_str());
+        else if constexpr (std::is_same_v<T, std::string>)
+            v.set_string(x.c_str());
+        else if constexpr (std::is_convertible_v<T, const char*>)
+            v.set_string(x);
+        else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+        {
+            if constexpr (sizeof(T) <= sizeof(sval_t))
+                v.set_long(sval_t(x));
+            else
+                v.set_int64(int64(x));
+        }
+        else
+            static_assert(!sizeof(T), "unsupported argument type");
+    }
+
+    /// Convert a result; false if its type does not fit the column
+    template <typename T>
+    bool get_result(idc_value_t& v, T& out)
+    {
+        if constexpr (std::is_same_v<T, idc_value_t>)
+        {
+            out.swap(v);
+            return true;
+        }
+        else if constexpr (std::is_same_v<T, qstring> || std::is_same_v<T, std::string>)
+        {
+            if (v.vtype != VT_STR)
+                return false;
+            out = v.c_str();
+            return true;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            if (v.vtype == VT_LONG)
+                out = std::is_same_v<T, bool> ? T(v.num != 0) : T(v.num);
+            else if (v.vtype == VT_INT64)
+                out = std::is_same_v<T, bool> ? T(v.i64 != 0) : T(v.i64);
+            else
+                return false;
+            return true;
+        }
+        else
+        {
+            static_assert(!sizeof(T), "unsupported result type");
+        }
+    }
+}
+
+/// Counters reported by batch_evaluator_t
+struct batch_eval_stats_t
+{
+    size_t calls = 0;        ///< Interpreter calls
+    size_t failures = 0;     ///< Calls that failed or returned an unusable type
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief Evaluates one compiled expression over many argument tuples.
+ *
+ * The argument array and the result value are allocated once and reused for
+ * every row, so a batch costs one interpreter call per row and no
+ * idc_value_t construction. Rows are scalars (one argument) or tuple-likes
+ * (std::tuple, std::pair, std::array) of integers, enums, strings or
+ * idc_value_t. Results are written to a typed column: integers, bool,
+ * qstring/std::string or idc_value_t.
+ *
+ * @example
+ * @code
+ * expr_cache_t cache;
+ * batch_evaluator_t eval{cache.get("idc", "get_wide_byte(ea) == 0xCC", "ea")};
+ * std::vector<ea_t> eas = ...;
+ * std::vector<uint8_t> is_int3(eas.size());
+ * eval.run(std::span<const ea_t>(eas), std::span<uint8_t>(is_int3));
+ * @endcode
+ */
+class batch_evaluator_t
+{
+private:
+    compiled_expr_ptr_t fn;
+    std::vector<idc_value_t> args;
+    idc_value_t rv;
+    qstring err;
+    batch_eval_stats_t st;
+
+public:
+    /**
+     * @param fn Compiled expression (see expr_cache_t::get())
+     */
+    explicit batch_evaluator_t(compiled_expr_ptr_t fn) : fn(std::move(fn))
+    {
+        if (this->fn != nullptr)
+            args.resize(this->fn->nparams);
+    }
+
+    /**
+     * @brief Evaluate every row.
+     *
+     * Rows whose call fails, or whose result does not fit Out, leave their
+     * output untouched and get ok[i] = 0.
+     *
+     * @param in Argument rows; each must have as many values as parameters
+     * @param out Output column (at least in.size() entries)
+     * @param ok Optional per-row success column
+     * @param stop_on_error Stop at the first failing row
+     * @return Number of rows evaluated successfully
+     */
+    template <typename Row, typename Out>
+    size_t run(std::span<const Row> in, std::span<Out> out, std::span<uint8_t> ok = {}, bool stop_on_error = false)
+    {
+        if (fn == nullptr || !fn->ok || batch_detail::arity<Row>() != args.size() || out.size() < in.size())
+        {
+            err = fn == nullptr ? qstring("no expression") : fn->ok ? qstring("argument count or output size mismatch") : fn->error;
+            return 0;
+        }
+
+        size_t good = 0;
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            if constexpr (batch_detail::is_tuple_like<Row>::value)
+            {
+                std::apply([this](const auto&... x)
+                {
+                    size_t k = 0;
+                    (batch_detail::set_arg(args[k++], x), ...);
+                }, in[i]);
+            }
+            else
+            {
+                batch_detail::set_arg(args[0], in[i]);
+            }
+
+            ++st.calls;
+            bool row_ok = fn->call(&rv, args.data(), args.size(), &err) && batch_detail::get_result(rv, out[i]);
+            if (i < ok.size())
+                ok[i] = row_ok ? 1 : 0;
+            if (row_ok)
+            {
+                ++good;
+                continue;
+            }
+            ++st.failures;
+            if (stop_on_error)
+                break;
+        }
+        return good;
+    }
+
+    /// Message of the last failure
+    const qstring& last_error() const { return err; }
+
+    /// Call counters
+    const batch_eval_stats_t& stats() const { return st; }
+};
+
+}  // namespace idacpp::expr
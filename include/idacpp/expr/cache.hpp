@@ -0,0 +1,348 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Expression utilities module - Compiled-expression cache
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <expr.hpp>
+
+#include <idacpp/expr/expr.hpp>
+
+namespace idacpp::expr
+{
+
+/**
+ * @brief An expression compiled into an interpreter function.
+ */
+struct compiled_expr_t
+{
+    extlang_t* lang = nullptr;   ///< Language, or nullptr for IDC
+    qstring func;                ///< Name of the compiled function
+    size_t nparams = 0;          ///< Declared parameters
+    bool ok = false;             ///< Compilation succeeded
+    qstring error;               ///< Compiler message if !ok
+
+    /**
+     * @brief Call the compiled function.
+     *
+     * @param rv Result
+     * @param args Arguments, one per declared parameter
+     * @param nargs Number of arguments
+     * @param errbuf Optional error message
+     * @return true on success
+     */
+    bool call(idc_value_t* rv, const idc_value_t args[], size_t nargs, qstring* errbuf = nullptr) const
+    {
+        if (!ok)
+        {
+            if (errbuf != nullptr)
+                *errbuf = error;
+            return false;
+        }
+        if (lang == nullptr)
+            return call_idc_func(rv, func.c_str(), args, nargs, errbuf);
+        return lang->call_func(rv, func.c_str(), args, nargs, errbuf);
+    }
+};
+
+/// Shared compiled expression; stays callable after eviction from the cache
+using compiled_expr_ptr_t = std::shared_ptr<const compiled_expr_t>;
+
+/// Counters reported by expr_cache_t
+struct expr_cache_stats_t
+{
+    size_t hits = 0;        ///< Lookups served from the cache
+    size_t misses = 0;      ///< Lookups that compiled
+    size_t failures = 0;    ///< Compilations that failed (cached as well)
+    size_t evictions = 0;   ///< Entries dropped by the LRU policy
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief LRU cache of compiled IDC and extlang expressions.
+ *
+ * Each distinct (language, parameters, source) is compiled once into a
+ * uniquely named interpreter function; later evaluations only pay for the
+ * call. IDC expressions without parameters go through compile_idc_snippet(),
+ * with parameters through compile_idc_text(); other languages use
+ * extlang_t::compile_expr(). Python expressions with parameters are compiled
+ * as a `def` through extlang_t::eval_snippet(), since compile_expr() creates
+ * parameterless functions. Failed compilations are cached too, so a bad
+ * filter is not recompiled on every call. IDC expressions may be compiled
+ * with an idc_resolver_t for names the IDC compiler does not know; the
+ * resolver's generation is part of the key, so bumping it recompiles them.
+ *
+ * Function names of evicted entries are reused once no compiled_expr_ptr_t
+ * refers to them, which bounds the number of functions left in the
+ * interpreters. Entries are recompiled after extlangs are installed or
+ * removed (see extlang_registry_t::generation()).
+ *
+ * @note Like the interpreters themselves, the cache is for the main thread.
+ *
+ * @example
+ * @code
+ * expr_cache_t cache;
+ * idc_value_t arg, rv;
+ * for (ea_t ea : eas)
+ * {
+ *     arg.set_int64(ea);
+ *     if (cache.eval(&rv, "idc", "get_wide_byte(ea) == 0xCC", "ea", &arg, 1) && rv.num != 0)
+ *         hits.push_back(ea);
+ * }
+ * @endcode
+ */
+class expr_cache_t
+{
+private:
+    struct entry_t
+    {
+        uint64_t hash;
+        extlang_t* lang;
+        idc_resolver_t* resolver;
+        std::string params;
+        std::string source;
+        uint64_t generation;
+        uint64_t resolver_gen;
+        compiled_expr_ptr_t compiled;
+    };
+    using lru_t = std::list<entry_t>;
+
+    size_t capacity;
+    lru_t lru;                                              ///< Most recently used first
+    std::unordered_map<uint64_t, lru_t::iterator> index;    ///< Hash to entry
+    std::vector<qstring> free_names;                        ///< Names of evicted functions
+    expr_cache_stats_t st;
+
+    static uint64_t hash_of(extlang_t* lang, idc_resolver_t* resolver, const char* params, const char* source)
+    {
+        // FNV-1a over both strings, seeded with the language and resolver
+        uint64_t h = 0xCBF29CE484222325ULL ^ (uint64_t(uintptr_t(lang)) * 0x9E3779B97F4A7C15ULL)
+                   ^ (uint64_t(uintptr_t(resolver)) * 0xC2B2AE3D27D4EB4FULL);
+        for (const char* s = params; *s != '\0'; ++s)
+            h = (h ^ uint8_t(*s)) * 0x100000001B3ULL;
+        h = (h ^ 0xFF) * 0x100000001B3ULL;
+        for (const char* s = source; *s != '\0'; ++s)
+            h = (h ^ uint8_t(*s)) * 0x100000001B3ULL;
+        return h;
+    }
+
+    static size_t count_params(const char* params)
+    {
+        size_t n = 0;
+        bool in_name = false;
+        for (const char* s = params; *s != '\0'; ++s)
+        {
+            bool sep = *s == ',' || *s == ' ' || *s == '\t';
+            if (!sep && !in_name)
+                ++n;
+            in_name = !sep;
+        }
+        return n;
+    }
+
+    qstring take_name()
+    {
+        if (!free_names.empty())
+        {
+            qstring name = free_names.back();
+            free_names.pop_back();
+            return name;
+        }
+        // Functions of every cache share the interpreter. The counter is
+        // per module (each plugin has its own copy of this static), so the
+        // counter's address tells modules apart.
+        static std::atomic<uint32_t> next_name{0};
+        qstring name;
+        name.sprnt("__idacpp_expr_%llx_%u", (unsigned long long)uintptr_t(&next_name), next_name.fetch_add(1));
+        return name;
+    }
+
+    void drop(lru_t::iterator p)
+    {
+        // A name still callable through a caller's pointer must stay unique
+        if (!p->compiled->ok || p->compiled.use_count() == 1)
+            free_names.push_back(p->compiled->func);
+        index.erase(p->hash);
+        lru.erase(p);
+    }
+
+    static compiled_expr_ptr_t compile(
+        extlang_t* lang,
+        idc_resolver_t* resolver,
+        const char* params,
+        const char* source,
+        qstring name)
+    {
+        auto c = std::make_shared<compiled_expr_t>();
+        c->lang = lang;
+        c->func = std::move(name);
+        c->nparams = count_params(params);
+
+        qstring text;
+        if (lang == nullptr)
+        {
+            if (c->nparams == 0)
+            {
+                text.sprnt("return (%s);", source);
+                c->ok = compile_idc_snippet(c->func.c_str(), text.c_str(), &c->error, resolver);
+            }
+            else
+            {
+                text.sprnt("static %s(%s) { return (%s); }", c->func.c_str(), params, source);
+                c->ok = compile_idc_text(text.c_str(), &c->error, resolver);
+            }
+        }
+        else if (c->nparams == 0)
+        {
+            c->ok = lang->compile_expr != nullptr
+                 && lang->compile_expr(c->func.c_str(), BADADDR, source, &c->error);
+        }
+        else if (lang->fileext != nullptr && streq(lang->fileext, "py") && lang->eval_snippet != nullptr)
+        {
+            text.sprnt("def %s(%s):\n    return (%s)\n", c->func.c_str(), params, source);
+            c->ok = lang->eval_snippet(text.c_str(), &c->error);
+        }
+        else
+        {
+            c->error = "parameters are only supported for IDC and Python expressions";
+        }
+        return c;
+    }
+
+public:
+    /**
+     * @param capacity Maximum number of cached expressions
+     */
+    explicit expr_cache_t(size_t capacity = 256) : capacity(capacity > 0 ? capacity : 1) {}
+
+    expr_cache_t(const expr_cache_t&) = delete;
+    expr_cache_t& operator=(const expr_cache_t&) = delete;
+
+    /**
+     * @brief Get the compiled form of an expression, compiling it on a miss.
+     *
+     * @param lang Language, or nullptr for IDC
+     * @param source Expression text
+     * @param params Comma-separated parameter names ("" for none)
+     * @param resolver Name resolver for IDC (ignored for other languages)
+     * @param resolver_gen Resolver state; entries compiled under another generation are recompiled
+     * @return Compiled expression; check `ok` before relying on it
+     */
+    compiled_expr_ptr_t get(
+        extlang_t* lang,
+        const char* source,
+        const char* params = "",
+        idc_resolver_t* resolver = nullptr,
+        uint64_t resolver_gen = 0)
+    {
+        params = params != nullptr ? params : "";
+        if (lang != nullptr || resolver == nullptr)
+        {
+            resolver = nullptr;
+            resolver_gen = 0;
+        }
+        uint64_t gen = extlang_registry_t::instance().generation();
+        uint64_t h = hash_of(lang, resolver, params, source);
+        auto p = index.find(h);
+        if (p != index.end())
+        {
+            auto e = p->second;
+            if (e->lang == lang && e->resolver == resolver && e->generation == gen
+             && e->resolver_gen == resolver_gen && e->params == params && e->source == source)
+            {
+                ++st.hits;
+                lru.splice(lru.begin(), lru, e);
+                return e->compiled;
+            }
+            // Stale entry or hash collision: replace it
+            drop(e);
+        }
+
+        ++st.misses;
+        while (lru.size() >= capacity)
+        {
+            drop(std::prev(lru.end()));
+            ++st.evictions;
+        }
+        auto c = compile(lang, resolver, params, source, take_name());
+        if (!c->ok)
+            ++st.failures;
+        lru.push_front(entry_t{h, lang, resolver, params, source, gen, resolver_gen, c});
+        index.emplace(h, lru.begin());
+        return c;
+    }
+
+    /**
+     * @brief Get a compiled expression by language extension ("idc", "py"...).
+     *
+     * @return Compiled expression, or nullptr if the language is not installed
+     */
+    compiled_expr_ptr_t get(const char* lang_ext, const char* source, const char* params = "")
+    {
+        if (lang_ext == nullptr || stricmp(lang_ext, "idc") == 0)
+            return get((extlang_t*)nullptr, source, params);
+        extlang_t* lang = extlang_registry_t::instance().find_by_ext(lang_ext);
+        return lang == nullptr ? nullptr : get(lang, source, params);
+    }
+
+    /**
+     * @brief Evaluate an expression, compiling it on first use.
+     *
+     * @param rv Result
+     * @param lang_ext Language extension ("idc", "py"...)
+     * @param source Expression text
+     * @param params Comma-separated parameter names
+     * @param args Arguments, one per parameter
+     * @param nargs Number of arguments
+     * @param errbuf Optional error message
+     * @return true on success
+     */
+    bool eval(
+        idc_value_t* rv,
+        const char* lang_ext,
+        const char* source,
+        const char* params = "",
+        const idc_value_t args[] = nullptr,
+        size_t nargs = 0,
+        qstring* errbuf = nullptr)
+    {
+        auto c = get(lang_ext, source, params);
+        if (c == nullptr)
+        {
+            if (errbuf != nullptr)
+                errbuf->sprnt("language '%s' is not installed", lang_ext);
+            return false;
+        }
+        return c->call(rv, args, nargs, errbuf);
+    }
+
+    /**
+     * @brief Drop every entry. Outstanding compiled_expr_ptr_t stay valid.
+     */
+    void clear()
+    {
+        while (!lru.empty())
+            drop(lru.begin());
+    }
+
+    /// Number of cached expressions
+    size_t size() const { return lru.size(); }
+
+    /// Hit/miss counters
+    const expr_cache_stats_t& stats() const { return st; }
+
+    /// Reset the counters
+    void reset_stats() { st = expr_cache_stats_t(); }
+};
+
+}  // namespace idacpp::expr
@@ -6,54 +6,226 @@ Expression utilities module
 */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <expr.hpp>
+#include <kernwin.hpp>
 
 namespace idacpp::expr
 {
 
 //-------------------------------------------------------------------------
 /**
- * @brief Find and cache the Python external language object.
+ * @brief Registry of the loaded external languages.
  *
- * Searches for the Python external language plugin and caches the result
- * for subsequent calls.
+ * Lists every extlang once and indexes it by file extension and by name
+ * (both case-insensitive), so lookups are a hash probe instead of a
+ * for_all_extlangs() walk. The table is immutable and published through an
+ * atomic pointer: lookups take no lock and may run on worker threads.
  *
- * @param force If true, force re-search even if cached
- * @return Pointer to Python extlang_t, or nullptr if not found
+ * The registry listens to ui_extlang_changed and rebuilds the table when a
+ * language is installed or removed. The first lookup builds it; do that on
+ * the main thread (e.g. at plugin init) before using the registry from
+ * workers, since enumerating extlangs is a kernel call.
  *
- * @note This function is useful when you need to evaluate Python expressions
- *       or interact with IDA's Python integration from C++.
+ * Replaced tables are kept until reset() so that a concurrent reader never
+ * sees freed memory; languages change rarely, so they cost almost nothing.
+ *
+ * @example
+ * @code
+ * auto& langs = extlang_registry_t::instance();
+ * if (extlang_t* py = langs.find_by_ext("py"))
+ *     py->eval_snippet("print(1)", &errbuf);
+ * @endcode
  */
-inline extlang_t* pylang(bool force = false)
+class extlang_registry_t : public event_listener_t
 {
-    struct find_python : extlang_visitor_t
+private:
+    struct table_t
     {
-        extlang_t** pylang;
+        std::vector<extlang_t*> langs;
+        std::unordered_map<std::string, extlang_t*> by_ext;
+        std::unordered_map<std::string, extlang_t*> by_name;
+    };
+
+    std::atomic<const table_t*> current{nullptr};
+    std::atomic<uint64_t> gen{0};
+    std::mutex lock;                                ///< Serializes rebuilds
+    std::vector<std::unique_ptr<table_t>> tables;   ///< Published and retired tables
+    bool hooked = false;
 
-        virtual ssize_t idaapi visit_extlang(extlang_t* extlang) override
+    extlang_registry_t() = default;
+
+    static std::string key_of(const char* s)
+    {
+        std::string key;
+        if (s != nullptr)
         {
-            if (streq(extlang->fileext, "py"))
-            {
-                *pylang = extlang;
-                return 1;
-            }
-            return 0;
+            for (; *s != '\0'; ++s)
+                key.push_back((*s >= 'A' && *s <= 'Z') ? char(*s - 'A' + 'a') : *s);
         }
+        return key;
+    }
 
-        find_python(extlang_t** pylang) : pylang(pylang)
+    const table_t* rebuild()
+    {
+        struct collect_t : extlang_visitor_t
         {
-            for_all_extlangs(*this, false);
-        }
-    };
+            table_t* t;
+            explicit collect_t(table_t* t) : t(t) {}
+            ssize_t idaapi visit_extlang(extlang_t* el) override
+            {
+                t->langs.push_back(el);
+                // The first language registered for a key wins, as in for_all_extlangs()
+                if (el->fileext != nullptr)
+                    t->by_ext.emplace(key_of(el->fileext), el);
+                if (el->name != nullptr)
+                    t->by_name.emplace(key_of(el->name), el);
+                return 0;
+            }
+        };
+
+        auto t = std::make_unique<table_t>();
+        collect_t collect{t.get()};
+        for_all_extlangs(collect, false);
+
+        if (!hooked)
+            hooked = hook_event_listener(HT_UI, this);
+
+        const table_t* published = t.get();
+        tables.push_back(std::move(t));
+        current.store(published, std::memory_order_release);
+        gen.fetch_add(1, std::memory_order_acq_rel);
+        return published;
+    }
+
+    const table_t* table()
+    {
+        const table_t* t = current.load(std::memory_order_acquire);
+        if (t != nullptr)
+            return t;
+        std::lock_guard<std::mutex> guard(lock);
+        t = current.load(std::memory_order_acquire);
+        return t != nullptr ? t : rebuild();
+    }
+
+    static extlang_t* find_in(const std::unordered_map<std::string, extlang_t*>& m, const char* key)
+    {
+        auto p = m.find(key_of(key));
+        return p == m.end() ? nullptr : p->second;
+    }
+
+public:
+    /**
+     * @brief Get the process-wide registry.
+     */
+    static extlang_registry_t& instance()
+    {
+        static extlang_registry_t inst;
+        return inst;
+    }
+
+    ~extlang_registry_t() override
+    {
+        reset();
+    }
+
+    extlang_registry_t(const extlang_registry_t&) = delete;
+    extlang_registry_t& operator=(const extlang_registry_t&) = delete;
+
+    ssize_t idaapi on_event(ssize_t code, va_list) override
+    {
+        if (code == ui_extlang_changed)
+            refresh();
+        return 0;
+    }
+
+    /**
+     * @brief Find a language by file extension ("py", "idc"...).
+     *
+     * @return Language, or nullptr if none is installed for the extension
+     */
+    extlang_t* find_by_ext(const char* ext)
+    {
+        return find_in(table()->by_ext, ext);
+    }
+
+    /**
+     * @brief Find a language by name ("Python", "IDC"...).
+     *
+     * @return Language, or nullptr if none has that name
+     */
+    extlang_t* find_by_name(const char* name)
+    {
+        return find_in(table()->by_name, name);
+    }
+
+    /// Every installed language, in registration order
+    const std::vector<extlang_t*>& all()
+    {
+        return table()->langs;
+    }
+
+    /**
+     * @brief Table generation, bumped by every rebuild.
+     *
+     * Caches of per-language state (e.g. compiled functions) compare it to
+     * notice that languages were installed or removed.
+     */
+    uint64_t generation() const { return gen.load(std::memory_order_acquire); }
 
-    static extlang_t* s_pylang = nullptr;
-    if (force || s_pylang == nullptr)
+    /**
+     * @brief Rebuild the table now (done automatically on ui_extlang_changed).
+     */
+    void refresh()
     {
-        s_pylang = nullptr;
-        find_python{&s_pylang};
+        std::lock_guard<std::mutex> guard(lock);
+        rebuild();
     }
 
-    return s_pylang;
+    /**
+     * @brief Unhook and free every table; the next lookup rebuilds.
+     *
+     * @note Must not run concurrently with lookups.
+     */
+    void reset()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (hooked)
+        {
+            unhook_event_listener(HT_UI, this);
+            hooked = false;
+        }
+        current.store(nullptr, std::memory_order_release);
+        tables.clear();
+    }
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief Find the Python external language object.
+ *
+ * Looks the language up in extlang_registry_t, which is kept current when
+ * languages are installed or removed.
+ *
+ * @param force If true, rebuild the registry before looking up
+ * @return Pointer to Python extlang_t, or nullptr if not found
+ *
+ * @note This function is useful when you need to evaluate Python expressions
+ *       or interact with IDA's Python integration from C++.
+ */
+inline extlang_t* pylang(bool force = false)
+{
+    auto& langs = extlang_registry_t::instance();
+    if (force)
+        langs.refresh();
+    return langs.find_by_ext("py");
 }
 
 }  // namespace idacpp::expr
@@ -0,0 +1,772 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Expression utilities module - Native evaluator for simple address expressions
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <bytes.hpp>
+#include <dbg.hpp>
+#include <expr.hpp>
+#include <idp.hpp>
+#include <kernwin.hpp>
+#include <name.hpp>
+
+#include <idacpp/expr/cache.hpp>
+
+namespace idacpp::expr
+{
+
+//-------------------------------------------------------------------------
+/**
+ * @brief Cache of name to address resolutions.
+ *
+ * Entries are dropped when a name is renamed and the whole cache when the
+ * database is closed; generation() changes each time, so expressions that
+ * baked addresses in know when to re-resolve. Lookups call get_name_ea() on
+ * a miss and are therefore for the main thread.
+ *
+ * Only user-defined names are cached. Failed lookups and autogenerated names
+ * (sub_, loc_, byte_...) come and go as functions and items are created and
+ * deleted, without a rename notification: they are looked up every time,
+ * and once one was served, creating or destroying functions, code or data
+ * also changes generation().
+ */
+class name_cache_t : public event_listener_t
+{
+private:
+    std::unordered_map<std::string, ea_t> names;
+    std::atomic<uint64_t> gen{1};
+    bool hooked = false;
+    bool volatile_served = false;   ///< A failed or autogenerated name was resolved since the last bump
+
+    name_cache_t() = default;
+
+public:
+    /**
+     * @brief Get the process-wide cache.
+     */
+    static name_cache_t& instance()
+    {
+        static name_cache_t inst;
+        return inst;
+    }
+
+    ~name_cache_t() override
+    {
+        if (hooked)
+            unhook_event_listener(HT_IDB, this);
+    }
+
+    name_cache_t(const name_cache_t&) = delete;
+    name_cache_t& operator=(const name_cache_t&) = delete;
+
+    ssize_t idaapi on_event(ssize_t code, va_list va) override
+    {
+        if (code == idb_event::renamed)
+        {
+            va_arg(va, ea_t);
+            const char* new_name = va_arg(va, const char*);
+            va_arg(va, int);
+            const char* old_name = va_arg(va, const char*);
+            if (new_name != nullptr)
+                names.erase(new_name);
+            if (old_name != nullptr)
+                names.erase(old_name);
+            gen.fetch_add(1, std::memory_order_acq_rel);
+        }
+        else if (code == idb_event::closebase)
+        {
+            clear();
+        }
+        else if (volatile_served
+              && (code == idb_event::func_added
+               || code == idb_event::deleting_func
+               || code == idb_event::make_code
+               || code == idb_event::make_data
+               || code == idb_event::destroyed_items))
+        {
+            // Autogenerated names may have appeared or disappeared
+            volatile_served = false;
+            gen.fetch_add(1, std::memory_order_acq_rel);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Resolve a name (cached for user-defined names).
+     *
+     * @return Address, or BADADDR if the name does not exist
+     */
+    ea_t resolve(const char* name)
+    {
+        if (!hooked)
+            hooked = hook_event_listener(HT_IDB, this);
+        auto p = names.find(name);
+        if (p != names.end())
+            return p->second;
+        ea_t ea = get_name_ea(BADADDR, name);
+        if (ea == BADADDR || has_dummy_name(get_flags(ea)))
+            volatile_served = true;
+        else
+            names.emplace(name, ea);
+        return ea;
+    }
+
+    /// Changes whenever cached resolutions may be stale
+    uint64_t generation() const { return gen.load(std::memory_order_acquire); }
+
+    /// Drop every entry
+    void clear()
+    {
+        names.clear();
+        gen.fetch_add(1, std::memory_order_acq_rel);
+    }
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief IDC name resolver backed by name_cache_t.
+ *
+ * Lets IDC fallbacks see the same database names as the native path. Names
+ * are baked in at compile time: pass name_cache_t::generation() as the
+ * expr_cache_t resolver generation so renames recompile the fallback.
+ */
+struct name_resolver_t : public idc_resolver_t
+{
+    uval_t idaapi resolve_name(const char* name) override
+    {
+        return name_cache_t::instance().resolve(name);
+    }
+
+    /**
+     * @brief Get the shared resolver.
+     */
+    static name_resolver_t& instance()
+    {
+        static name_resolver_t inst;
+        return inst;
+    }
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief Native compiler and evaluator for simple integer expressions.
+ *
+ * Handles the subset users mostly type in address fields and filters:
+ * decimal, hex (0x), binary (0b) and octal literals, names, parameters,
+ * debugger registers, parentheses and the C/IDC integer operators
+ * (unary - ~ ! +, * / %, + -, << >>, comparisons, & ^ |, && ||) with IDC's
+ * signed 64-bit semantics. The expression is compiled to a compact stack
+ * bytecode with constant folding; names are resolved once through
+ * name_cache_t and re-resolved after renames.
+ *
+ * Anything else (strings, calls, ternaries, unknown names) compiles to an
+ * IDC fallback through expr_cache_t, and so do runtime errors such as a
+ * division by zero. The fallback is compiled with name_resolver_t, so it
+ * sees the same database names and is recompiled after renames.
+ *
+ * The const eval() reads only the bytecode and bound values: it may be
+ * called from worker threads when thread_safe() is true (native, no
+ * registers), provided bind() and the idc_value_t overload, which rebinds,
+ * do not run on the main thread at the same time. Call bind() before
+ * handing the expression to workers.
+ *
+ * @example
+ * @code
+ * native_expr_t e;
+ * e.compile("start + 0x10 & ~0xF", "start");
+ * int64 args[] = {int64(func->start_ea)}, v;
+ * if (e.eval(&v, args, 1))
+ *     jumpto(ea_t(v));
+ * @endcode
+ */
+class native_expr_t
+{
+private:
+    enum op_t : uint8_t
+    {
+        OP_CONST, OP_ARG, OP_NAME, OP_REG,
+        OP_NEG, OP_NOT, OP_LNOT, OP_BOOL,
+        OP_MUL, OP_DIV, OP_MOD, OP_ADD, OP_SUB, OP_SHL, OP_SHR,
+        OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+        OP_AND, OP_XOR, OP_OR,
+        OP_LAND, OP_LOR,    ///< Short-circuit: arg is the jump target
+    };
+
+    struct insn_t
+    {
+        op_t op;
+        uint32_t arg;   ///< Constant, argument, name or register index, or jump target
+    };
+
+    struct name_slot_t
+    {
+        std::string name;
+        int64 value;
+    };
+
+    static constexpr size_t MAX_STACK = 32;
+
+    // Compiled program
+    std::vector<insn_t> code;
+    std::vector<int64> consts;
+    std::vector<name_slot_t> slots;     ///< Names, bound to addresses
+    std::vector<std::string> regs;      ///< Debugger registers, read at eval time
+    size_t nparams = 0;
+    bool compiled = false;  ///< Compiled to bytecode
+    bool native = false;    ///< Compiled and every name is bound
+    uint64_t names_gen = 0;
+
+    // IDC fallback
+    std::string source;
+    std::string params;
+    expr_cache_t* cache = nullptr;
+    compiled_expr_ptr_t fallback;
+    qstring err;
+
+    // Parser state
+    const char* p = nullptr;
+    std::vector<std::string> param_names;
+    size_t depth = 0;
+    size_t max_depth = 0;
+    size_t barrier = 0;     ///< Instructions before the last jump target are not folded
+
+    static expr_cache_t& default_cache()
+    {
+        static expr_cache_t inst;
+        return inst;
+    }
+
+    static bool is_ident_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool is_ident_char(char c) { return is_ident_start(c) || (c >= '0' && c <= '9'); }
+
+    void skip_ws()
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            ++p;
+    }
+
+    bool accept(const char* tok)
+    {
+        skip_ws();
+        size_t n = strlen(tok);
+        if (strncmp(p, tok, n) != 0)
+            return false;
+        // Do not split longer operators: "<" must not match "<<" or "<="
+        char next = p[n];
+        if (n == 1 && (next == tok[0] || next == '=') && strchr("<>&|+-", tok[0]) != nullptr)
+            return false;
+        if (n == 1 && next == '=' && strchr("!=", tok[0]) != nullptr)
+            return false;
+        p += n;
+        return true;
+    }
+
+    void push(op_t op, uint32_t arg, int delta)
+    {
+        code.push_back(insn_t{op, arg});
+        depth = size_t(int(depth) + delta);
+        max_depth = std::max(max_depth, depth);
+    }
+
+    void push_const(int64 v)
+    {
+        consts.push_back(v);
+        push(OP_CONST, uint32_t(consts.size() - 1), 1);
+    }
+
+    bool last_is_const(size_t k) const
+    {
+        if (code.size() < k || code.size() - k < barrier)
+            return false;
+        for (size_t i = code.size() - k; i < code.size(); ++i)
+            if (code[i].op != OP_CONST)
+                return false;
+        return true;
+    }
+
+    /// Apply an operator; false on a runtime error (division by zero...)
+    static bool apply(op_t op, int64 a, int64 b, int64* r)
+    {
+        switch (op)
+        {
+            case OP_NEG:  *r = int64(0 - uint64(a)); return true;
+            case OP_NOT:  *r = ~a; return true;
+            case OP_LNOT: *r = a == 0; return true;
+            case OP_BOOL: *r = a != 0; return true;
+            case OP_MUL:  *r = int64(uint64(a) * uint64(b)); return true;
+            case OP_DIV:
+            case OP_MOD:
+                if (b == 0 || (b == -1 && a == INT64_MIN))
+                    return false;
+                *r = op == OP_DIV ? a / b : a % b;
+                return true;
+            case OP_ADD:  *r = int64(uint64(a) + uint64(b)); return true;
+            case OP_SUB:  *r = int64(uint64(a) - uint64(b)); return true;
+            case OP_SHL:
+            case OP_SHR:
+                if (b < 0 || b > 63)
+                    return false;
+                *r = op == OP_SHL ? int64(uint64(a) << b) : a >> b;
+                return true;
+            case OP_LT:   *r = a < b; return true;
+            case OP_LE:   *r = a <= b; return true;
+            case OP_GT:   *r = a > b; return true;
+            case OP_GE:   *r = a >= b; return true;
+            case OP_EQ:   *r = a == b; return true;
+            case OP_NE:   *r = a != b; return true;
+            case OP_AND:  *r = a & b; return true;
+            case OP_XOR:  *r = a ^ b; return true;
+            case OP_OR:   *r = a | b; return true;
+            default:      return false;
+        }
+    }
+
+    void emit_unary(op_t op)
+    {
+        int64 r;
+        if (last_is_const(1) && apply(op, consts[code.back().arg], 0, &r))
+        {
+            consts[code.back().arg] = r;
+            return;
+        }
+        push(op, 0, 0);
+    }
+
+    void emit_binary(op_t op)
+    {
+        int64 r;
+        if (last_is_const(2) && apply(op, consts[code[code.size() - 2].arg], consts[code.back().arg], &r))
+        {
+            if (code.back().arg + 1 == consts.size())
+                consts.pop_back();
+            code.pop_back();
+            consts[code.back().arg] = r;
+            --depth;
+            return;
+        }
+        push(op, 0, -1);
+    }
+
+    bool parse_number()
+    {
+        uint64 v = 0;
+        int base = 10;
+        if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        {
+            base = 16;
+            p += 2;
+        }
+        else if (p[0] == '0' && (p[1] == 'b' || p[1] == 'B'))
+        {
+            base = 2;
+            p += 2;
+        }
+        else if (p[0] == '0')
+        {
+            base = 8;
+        }
+        const char* start = p;
+        for (;; ++p)
+        {
+            int d;
+            if (*p >= '0' && *p <= '9')
+                d = *p - '0';
+            else if (*p >= 'a' && *p <= 'f')
+                d = *p - 'a' + 10;
+            else if (*p >= 'A' && *p <= 'F')
+                d = *p - 'A' + 10;
+            else
+                break;
+            if (d >= base)
+                return false;
+            v = v * uint64(base) + uint64(d);
+        }
+        // Suffixes and malformed literals are left to IDC
+        if (p == start || is_ident_char(*p))
+            return false;
+        push_const(int64(v));
+        return true;
+    }
+
+    bool parse_ident()
+    {
+        const char* start = p;
+        while (is_ident_char(*p))
+            ++p;
+        std::string name(start, p);
+        skip_ws();
+        if (*p == '(' || *p == '.' || *p == '[')
+            return false;   // Calls, members and subscripts
+
+        for (size_t i = 0; i < param_names.size(); ++i)
+        {
+            if (param_names[i] == name)
+            {
+                push(OP_ARG, uint32_t(i), 1);
+                return true;
+            }
+        }
+        if (is_debugger_on() && is_reg_integer(name.c_str()))
+        {
+            regs.push_back(name);
+            push(OP_REG, uint32_t(regs.size() - 1), 1);
+            return true;
+        }
+        ea_t ea = name_cache_t::instance().resolve(name.c_str());
+        if (ea == BADADDR)
+            return false;
+        slots.push_back(name_slot_t{name, int64(ea)});
+        push(OP_NAME, uint32_t(slots.size() - 1), 1);
+        return true;
+    }
+
+    bool parse_primary()
+    {
+        skip_ws();
+        if (*p >= '0' && *p <= '9')
+            return parse_number();
+        if (is_ident_start(*p))
+            return parse_ident();
+        if (accept("("))
+            return parse_expr(0) && accept(")");
+        return false;
+    }
+
+    bool parse_unary()
+    {
+        if (accept("-"))
+            return parse_unary() && (emit_unary(OP_NEG), true);
+        if (accept("~"))
+            return parse_unary() && (emit_unary(OP_NOT), true);
+        if (accept("!"))
+            return parse_unary() && (emit_unary(OP_LNOT), true);
+        if (accept("+"))
+            return parse_unary();
+        return parse_primary();
+    }
+
+    struct binop_t
+    {
+        const char* tok;
+        int prec;
+        op_t op;
+    };
+
+    bool match_binop(int min_prec, binop_t* out)
+    {
+        static const binop_t ops[] =
+        {
+            {"||", 1, OP_LOR}, {"&&", 2, OP_LAND},
+            {"|", 3, OP_OR}, {"^", 4, OP_XOR}, {"&", 5, OP_AND},
+            {"==", 6, OP_EQ}, {"!=", 6, OP_NE},
+            {"<=", 7, OP_LE}, {">=", 7, OP_GE}, {"<<", 8, OP_SHL}, {">>", 8, OP_SHR},
+            {"<", 7, OP_LT}, {">", 7, OP_GT},
+            {"+", 9, OP_ADD}, {"-", 9, OP_SUB},
+            {"*", 10, OP_MUL}, {"/", 10, OP_DIV}, {"%", 10, OP_MOD},
+        };
+        for (auto& b : ops)
+        {
+            if (b.prec < min_prec)
+                continue;
+            const char* save = p;
+            if (accept(b.tok))
+            {
+                *out = b;
+                return true;
+            }
+            p = save;
+        }
+        return false;
+    }
+
+    bool parse_logical(op_t op, int prec)
+    {
+        // Constant left side: decide now and drop the dead right side
+        if (last_is_const(1))
+        {
+            size_t lhs = code.size() - 1;
+            bool lhs_true = consts[code[lhs].arg] != 0;
+            bool shortcut = op == OP_LAND ? !lhs_true : lhs_true;
+            size_t ncode = code.size(), nconsts = consts.size(), d = depth, b = barrier;
+            if (!parse_expr(prec + 1))
+                return false;
+            if (shortcut)
+            {
+                code.resize(ncode);
+                consts.resize(nconsts);
+                depth = d;
+                barrier = b;
+                consts[code[lhs].arg] = op == OP_LAND ? 0 : 1;
+                return true;
+            }
+            // The result is the right side as a boolean
+            code.erase(code.begin() + lhs);
+            --depth;
+            if (barrier > lhs)
+                --barrier;
+            for (size_t i = lhs; i < code.size(); ++i)
+                if (code[i].op == OP_LAND || code[i].op == OP_LOR)
+                    --code[i].arg;
+            emit_unary(OP_BOOL);
+            return true;
+        }
+
+        size_t jump = code.size();
+        push(op, 0, -1);
+        if (!parse_expr(prec + 1))
+            return false;
+        emit_unary(OP_BOOL);
+        code[jump].arg = uint32_t(code.size());
+        barrier = code.size();
+        return true;
+    }
+
+    bool parse_expr(int min_prec)
+    {
+        if (!parse_unary())
+            return false;
+        binop_t b;
+        while (match_binop(min_prec, &b))
+        {
+            if (b.op == OP_LAND || b.op == OP_LOR)
+            {
+                if (!parse_logical(b.op, b.prec))
+                    return false;
+                continue;
+            }
+            if (!parse_expr(b.prec + 1))
+                return false;
+            emit_binary(b.op);
+        }
+        return true;
+    }
+
+    bool run(int64* out, const int64 args[], size_t nargs) const
+    {
+        int64 stack[MAX_STACK];
+        size_t sp = 0;
+        for (size_t pc = 0; pc < code.size(); ++pc)
+        {
+            const insn_t& in = code[pc];
+            switch (in.op)
+            {
+                case OP_CONST:
+                    stack[sp++] = consts[in.arg];
+                    break;
+                case OP_ARG:
+                    if (in.arg >= nargs)
+                        return false;
+                    stack[sp++] = args[in.arg];
+                    break;
+                case OP_NAME:
+                    stack[sp++] = slots[in.arg].value;
+                    break;
+                case OP_REG:
+                {
+                    uint64 v;
+                    if (!get_reg_val(regs[in.arg].c_str(), &v))
+                        return false;
+                    stack[sp++] = int64(v);
+                    break;
+                }
+                case OP_NEG:
+                case OP_NOT:
+                case OP_LNOT:
+                case OP_BOOL:
+                    apply(in.op, stack[sp - 1], 0, &stack[sp - 1]);
+                    break;
+                case OP_LAND:
+                case OP_LOR:
+                {
+                    bool v = stack[--sp] != 0;
+                    if (v == (in.op == OP_LOR))
+                    {
+                        stack[sp++] = v ? 1 : 0;
+                        pc = in.arg - 1;
+                    }
+                    break;
+                }
+                default:
+                    --sp;
+                    if (!apply(in.op, stack[sp - 1], stack[sp], &stack[sp - 1]))
+                        return false;
+                    break;
+            }
+        }
+        *out = stack[0];
+        return true;
+    }
+
+    bool use_fallback(idc_value_t* rv, const idc_value_t args[], size_t nargs, qstring* errbuf)
+    {
+        if (fallback == nullptr)
+        {
+            fallback = cache->get((extlang_t*)nullptr, source.c_str(), params.c_str(),
+                                  &name_resolver_t::instance(), names_gen);
+        }
+        return fallback->call(rv, args, nargs, errbuf);
+    }
+
+public:
+    /**
+     * @brief Compile an expression.
+     *
+     * @param expr Expression text
+     * @param param_list Comma-separated parameter names, bound to eval() arguments in order
+     * @param fallback_cache Cache for the IDC fallback (a shared one if nullptr)
+     * @return true if the expression runs natively; false if it will use IDC
+     */
+    bool compile(const char* expr, const char* param_list = "", expr_cache_t* fallback_cache = nullptr)
+    {
+        source = expr != nullptr ? expr : "";
+        params = param_list != nullptr ? param_list : "";
+        cache = fallback_cache != nullptr ? fallback_cache : &default_cache();
+        fallback.reset();
+        code.clear();
+        consts.clear();
+        slots.clear();
+        regs.clear();
+        err.clear();
+
+        param_names.clear();
+        for (const char* s = params.c_str(); *s != '\0';)
+        {
+            while (*s == ',' || *s == ' ' || *s == '\t')
+                ++s;
+            const char* start = s;
+            while (*s != '\0' && *s != ',' && *s != ' ' && *s != '\t')
+                ++s;
+            if (s != start)
+                param_names.emplace_back(start, s);
+        }
+        nparams = param_names.size();
+
+        names_gen = name_cache_t::instance().generation();
+        p = source.c_str();
+        depth = max_depth = barrier = 0;
+        native = parse_expr(0);
+        skip_ws();
+        native = native && *p == '\0' && !code.empty() && max_depth <= MAX_STACK;
+        if (!native)
+        {
+            err.sprnt("not a simple expression at offset %d, using IDC", int(p - source.c_str()));
+            code.clear();
+            consts.clear();
+            slots.clear();
+            regs.clear();
+        }
+        p = nullptr;
+        compiled = native;
+        return native;
+    }
+
+    /// true if the expression runs natively
+    bool is_native() const { return native; }
+
+    /// true if the const eval() may be called from any thread
+    bool thread_safe() const { return native && regs.empty(); }
+
+    /// Number of bytecode instructions
+    size_t code_size() const { return code.size(); }
+
+    /// Why the expression is not native
+    const qstring& error() const { return err; }
+
+    /**
+     * @brief Re-resolve the names if any was renamed since compile() or the last bind().
+     *
+     * Not thread safe: writes the bound values read by the const eval().
+     *
+     * @return false if a name no longer resolves (eval() then uses IDC
+     *         until the name exists again)
+     */
+    bool bind()
+    {
+        auto& names = name_cache_t::instance();
+        uint64_t g = names.generation();
+        if (g == names_gen)
+            return native;
+        names_gen = g;
+        fallback.reset();
+        if (!compiled)
+            return false;
+        native = true;
+        for (auto& s : slots)
+        {
+            ea_t ea = names.resolve(s.name.c_str());
+            if (ea == BADADDR)
+            {
+                native = false;
+                err.sprnt("name '%s' no longer exists, using IDC", s.name.c_str());
+                continue;
+            }
+            s.value = int64(ea);
+        }
+        if (native)
+            err.clear();
+        return native;
+    }
+
+    /**
+     * @brief Evaluate natively with the bound names.
+     *
+     * @param out Result
+     * @param args Parameter values
+     * @param nargs Number of parameter values
+     * @return false if the expression is not native or hit a runtime error
+     */
+    bool eval(int64* out, const int64 args[] = nullptr, size_t nargs = 0) const
+    {
+        return native && run(out, args, nargs);
+    }
+
+    /**
+     * @brief Evaluate on the main thread, falling back to IDC when needed.
+     *
+     * Rebinds renamed names first. Integer arguments are used natively;
+     * anything else goes to IDC.
+     *
+     * @param rv Result
+     * @param args Parameter values
+     * @param nargs Number of parameter values
+     * @param errbuf Optional error message
+     * @return true on success
+     */
+    bool eval(idc_value_t* rv, const idc_value_t args[] = nullptr, size_t nargs = 0, qstring* errbuf = nullptr)
+    {
+        if (bind() && nargs == nparams && nargs <= MAX_STACK)
+        {
+            int64 iargs[MAX_STACK];
+            bool ints = true;
+            for (size_t i = 0; i < nargs && ints; ++i)
+            {
+                if (args[i].vtype == VT_LONG)
+                    iargs[i] = args[i].num;
+                else if (args[i].vtype == VT_INT64)
+                    iargs[i] = args[i].i64;
+                else
+                    ints = false;
+            }
+            int64 v;
+            if (ints && run(&v, iargs, nargs))
+            {
+                rv->set_long(sval_t(v));
+                return true;
+            }
+        }
+        return use_fallback(rv, args, nargs, errbuf);
+    }
+};
+
+}  // namespace idacpp::expr
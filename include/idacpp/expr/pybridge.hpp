@@ -0,0 +1,240 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Expression utilities module - Batched Python call bridge
+*/
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <expr.hpp>
+
+#include <idacpp/expr/expr.hpp>
+
+namespace idacpp::expr
+{
+
+/// How a batch is handed to the Python callable
+enum py_batch_mode_t
+{
+    PYB_ITEMS,   ///< fn(item) per item, looped inside Python
+    PYB_LIST,    ///< fn(list) once; returns an iterable of results
+    PYB_VIEW,    ///< fn(memoryview) once, zero-copy; returns an iterable or buffer of results
+};
+
+/// struct/memoryview format character of a column element type
+template <typename T>
+constexpr char py_format()
+{
+    static_assert(std::is_arithmetic_v<T>, "columns must hold integers, bool or floating point values");
+    if constexpr (std::is_same_v<T, bool>)
+        return '?';
+    else if constexpr (std::is_same_v<T, float>)
+        return 'f';
+    else if constexpr (std::is_same_v<T, double>)
+        return 'd';
+    else if constexpr (sizeof(T) == 1)
+        return std::is_signed_v<T> ? 'b' : 'B';
+    else if constexpr (sizeof(T) == 2)
+        return std::is_signed_v<T> ? 'h' : 'H';
+    else if constexpr (sizeof(T) == 4)
+        return std::is_signed_v<T> ? 'i' : 'I';
+    else
+        return std::is_signed_v<T> ? 'q' : 'Q';
+}
+
+/// Counters reported by py_bridge_t
+struct py_bridge_stats_t
+{
+    size_t batches = 0;   ///< Interpreter round-trips
+    size_t items = 0;     ///< Items processed
+    size_t errors = 0;    ///< Failed batches
+};
+
+//-------------------------------------------------------------------------
+/**
+ * @brief Calls a Python callable on a whole column in one round-trip.
+ *
+ * A small helper is defined once in the Python interpreter. Each batch is one
+ * extlang_t::call_func() of that helper with the addresses of the input and
+ * output columns. The helper wraps both in memoryviews (no copy), resolves
+ * the callable and runs the loop in Python, writing results straight into
+ * the output column. Entering the interpreter and marshaling therefore
+ * happen once per batch instead of once per item.
+ *
+ * The callable is named by a Python expression evaluated in `__main__`
+ * ("my_filter", "mymod.Scorer().score", "lambda ea: ea & 1"...).
+ *
+ * @note Main thread only. The columns must stay alive during the call; the
+ *       callable must not keep the memoryview passed in PYB_VIEW mode.
+ *
+ * @example
+ * @code
+ * py_bridge_t py;
+ * std::vector<ea_t> eas = ...;
+ * std::vector<uint8_t> keep(eas.size());
+ * py.map("lambda ea: ida_bytes.is_code(ida_bytes.get_flags(ea))",
+ *        std::span<const ea_t>(eas), std::span<uint8_t>(keep));
+ * @endcode
+ */
+class py_bridge_t
+{
+private:
+    static constexpr const char* HELPER = "__idacpp_pybridge";
+
+    extlang_t* lang = nullptr;
+    uint64_t gen = 0;
+    idc_value_t args[7];
+    idc_value_t rv;
+    qstring err;
+    py_bridge_stats_t st;
+
+    bool ensure()
+    {
+        auto& langs = extlang_registry_t::instance();
+        if (lang != nullptr && gen == langs.generation())
+            return true;
+
+        lang = langs.find_by_ext("py");
+        gen = langs.generation();
+        if (lang == nullptr || lang->eval_snippet == nullptr || lang->call_func == nullptr)
+        {
+            lang = nullptr;
+            err = "Python is not available";
+            return false;
+        }
+
+        static const char helper[] =
+            "def __idacpp_pybridge(fn_expr, mode, in_addr, in_fmt, out_addr, out_fmt, n):\n"
+            "    import ctypes, struct, __main__\n"
+            "    mk = ctypes.pythonapi.PyMemoryView_FromMemory\n"
+            "    mk.restype = ctypes.py_object\n"
+            "    mk.argtypes = (ctypes.c_void_p, ctypes.c_ssize_t, ctypes.c_int)\n"
+            "    mask = 0xFFFFFFFFFFFFFFFF\n"
+            "    src = mk(in_addr & mask, n * struct.calcsize(in_fmt), 0x100).cast(in_fmt)\n"
+            "    dst = mk(out_addr & mask, n * struct.calcsize(out_fmt), 0x200).cast(out_fmt)\n"
+            "    fn = eval(fn_expr, __main__.__dict__)\n"
+            "    if mode == 0:\n"
+            "        for i, x in enumerate(src):\n"
+            "            dst[i] = fn(x)\n"
+            "        return n\n"
+            "    res = fn(src.tolist() if mode == 1 else src)\n"
+            "    try:\n"
+            "        m = memoryview(res)\n"
+            "    except TypeError:\n"
+            "        m = None\n"
+            "    if m is not None and m.ndim == 1 and m.format == out_fmt:\n"
+            "        k = min(len(m), n)\n"
+            "        dst[:k] = m[:k]\n"
+            "        return k\n"
+            "    k = 0\n"
+            "    for r in res:\n"
+            "        if k == n:\n"
+            "            break\n"
+            "        dst[k] = r\n"
+            "        k += 1\n"
+            "    return k\n";
+        if (!lang->eval_snippet(helper, &err))
+        {
+            lang = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    ssize_t call(const char* fn, py_batch_mode_t mode, const void* in, char in_fmt, void* out, char out_fmt, size_t n)
+    {
+        char fmt[2] = {0, 0};
+        args[0].set_string(fn);
+        args[1].set_long(sval_t(mode));
+        args[2].set_int64(int64(uintptr_t(in)));
+        fmt[0] = in_fmt;
+        args[3].set_string(fmt);
+        args[4].set_int64(int64(uintptr_t(out)));
+        fmt[0] = out_fmt;
+        args[5].set_string(fmt);
+        args[6].set_int64(int64(n));
+
+        ++st.batches;
+        if (!lang->call_func(&rv, HELPER, args, qnumber(args), &err))
+        {
+            ++st.errors;
+            return -1;
+        }
+        ssize_t k = rv.vtype == VT_INT64 ? ssize_t(rv.i64) : ssize_t(rv.num);
+        st.items += size_t(k);
+        return k;
+    }
+
+public:
+    /**
+     * @brief Apply a Python callable to every item of a column.
+     *
+     * @param fn Python expression naming the callable
+     * @param in Input column
+     * @param out Output column (at least in.size() entries)
+     * @param mode How items are passed (see py_batch_mode_t)
+     * @param errbuf Optional error message (the Python exception)
+     * @return Number of results written, or -1 on error
+     */
+    template <typename In, typename Out>
+    ssize_t map(
+        const char* fn,
+        std::span<const In> in,
+        std::span<Out> out,
+        py_batch_mode_t mode = PYB_ITEMS,
+        qstring* errbuf = nullptr)
+    {
+        ssize_t k = -1;
+        if (out.size() < in.size())
+            err = "output column is too small";
+        else if (in.empty())
+            k = 0;
+        else if (ensure())
+            k = call(fn, mode, in.data(), py_format<In>(), out.data(), py_format<Out>(), in.size());
+        if (k < 0 && errbuf != nullptr)
+            *errbuf = err;
+        return k;
+    }
+
+    /**
+     * @brief Keep the items for which a Python predicate is true.
+     *
+     * @param fn Python expression naming the predicate
+     * @param in Input column
+     * @param out Kept items, in order
+     * @param mode How items are passed (see py_batch_mode_t)
+     * @param errbuf Optional error message
+     * @return Number of kept items, or -1 on error
+     */
+    template <typename In>
+    ssize_t filter(
+        const char* fn,
+        std::span<const In> in,
+        std::vector<In>& out,
+        py_batch_mode_t mode = PYB_ITEMS,
+        qstring* errbuf = nullptr)
+    {
+        out.clear();
+        std::vector<uint8_t> keep(in.size());
+        ssize_t k = map(fn, in, std::span<uint8_t>(keep), mode, errbuf);
+        if (k < 0)
+            return -1;
+        for (size_t i = 0; i < size_t(k); ++i)
+            if (keep[i] != 0)
+                out.push_back(in[i]);
+        return ssize_t(out.size());
+    }
+
+    /// Message of the last failure
+    const qstring& last_error() const { return err; }
+
+    /// Round-trip counters
+    const py_bridge_stats_t& stats() const { return st; }
+};
+
+}  // namespace idacpp::expr
@@ -0,0 +1,429 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Batched user annotation transactions
+*/
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include <hexrays.hpp>
+#include <kernwin.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/batch.hpp>
+
+namespace idacpp::hexrays
+{
+
+// Annotation commit flags:
+#define ATX_NONE       0x00  ///< Only persist
+#define ATX_REFRESH    0x01  ///< Refresh open pseudocode views of the changed functions
+
+/// Counters reported by annotation_txn_t::commit()
+struct annotation_stats_t
+{
+    size_t funcs = 0;        ///< Functions written
+    size_t edits = 0;        ///< Staged edits applied
+    size_t saves = 0;        ///< save_user_* calls
+    size_t refreshed = 0;    ///< Pseudocode views refreshed
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Tracks the open pseudocode widgets.
+ *
+ * The SDK cannot enumerate widgets, so the tracker follows
+ * ui_widget_visible/ui_widget_invisible and keeps the widgets whose type is
+ * BWN_PSEUDOCODE, whatever their title. Views opened before the tracker is
+ * first used are only found while they are the current widget.
+ */
+class pseudocode_views_t : public event_listener_t
+{
+private:
+    std::vector<TWidget*> views;
+    bool hooked = false;
+
+    pseudocode_views_t()
+    {
+        hooked = hook_event_listener(HT_UI, this);
+    }
+
+public:
+    /**
+     * @brief Get the process-wide tracker, installing it on first use.
+     */
+    static pseudocode_views_t& instance()
+    {
+        static pseudocode_views_t inst;
+        return inst;
+    }
+
+    ~pseudocode_views_t() override
+    {
+        if (hooked)
+            unhook_event_listener(HT_UI, this);
+    }
+
+    pseudocode_views_t(const pseudocode_views_t&) = delete;
+    pseudocode_views_t& operator=(const pseudocode_views_t&) = delete;
+
+    ssize_t idaapi on_event(ssize_t code, va_list va) override
+    {
+        if (code == ui_widget_visible)
+        {
+            TWidget* w = va_arg(va, TWidget*);
+            if (get_widget_type(w) == BWN_PSEUDOCODE && std::find(views.begin(), views.end(), w) == views.end())
+                views.push_back(w);
+        }
+        else if (code == ui_widget_invisible)
+        {
+            TWidget* w = va_arg(va, TWidget*);
+            views.erase(std::remove(views.begin(), views.end(), w), views.end());
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Call a function for every open pseudocode view.
+     *
+     * @param fn Callback receiving a vdui_t*
+     */
+    template <typename F>
+    void for_each(F&& fn) const
+    {
+        TWidget* cur = get_current_widget();
+        if (cur != nullptr
+         && get_widget_type(cur) == BWN_PSEUDOCODE
+         && std::find(views.begin(), views.end(), cur) == views.end())
+        {
+            if (vdui_t* vu = get_widget_vdui(cur); vu != nullptr)
+                fn(vu);
+        }
+        for (TWidget* w : views)
+        {
+            if (vdui_t* vu = get_widget_vdui(w); vu != nullptr)
+                fn(vu);
+        }
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Stages user annotations and persists them in one go.
+ *
+ * Setting a comment or renaming a variable through cfunc_t usually means one
+ * save_user_*() or modify_user_lvar_info() call plus one refresh per edit.
+ * The transaction instead records edits per function and, on commit(), loads
+ * each affected kind once, applies every edit, saves it once and refreshes
+ * each open view once, so the cost follows the number of functions rather
+ * than the number of edits.
+ *
+ * Later edits of the same location replace earlier ones. Setting an empty
+ * comment, label or zero iflags removes the user setting. Uncommitted edits
+ * are discarded on destruction.
+ *
+ * @example
+ * @code
+ * annotation_txn_t txn;
+ * for (auto& [ea, text] : notes)
+ *     txn.set_cmt(func_ea, treeloc_t{ea, ITP_SEMI}, text.c_str());
+ * txn.rename_lvar(func_ea, cfunc->get_lvars()->at(0), "ctx");
+ * txn.commit();
+ * @endcode
+ */
+class annotation_txn_t
+{
+private:
+    // What an lvar edit changes
+    static constexpr uint8_t LVE_NAME = 0x01;
+    static constexpr uint8_t LVE_TYPE = 0x02;
+    static constexpr uint8_t LVE_CMT  = 0x04;
+
+    struct lvar_edit_t
+    {
+        uint8_t what = 0;
+        qstring name;
+        tinfo_t type;
+        qstring cmt;
+    };
+
+    struct func_edits_t
+    {
+        std::map<treeloc_t, qstring> cmts;
+        std::map<operand_locator_t, std::optional<number_format_t>> numforms;
+        std::map<citem_locator_t, int32> iflags;
+        std::map<int, qstring> labels;
+        std::map<lvar_locator_t, lvar_edit_t> lvars;
+
+        size_t size() const
+        {
+            return cmts.size() + numforms.size() + iflags.size() + labels.size() + lvars.size();
+        }
+    };
+
+    std::map<ea_t, func_edits_t> funcs;
+    cfunc_cache_t* cache;
+
+    void apply_cmts(ea_t func_ea, const func_edits_t& e, annotation_stats_t& st)
+    {
+        user_cmts_t* m = restore_user_cmts(func_ea);
+        if (m == nullptr)
+            m = user_cmts_new();
+        for (auto& [loc, text] : e.cmts)
+        {
+            auto p = user_cmts_find(m, loc);
+            if (p != user_cmts_end(m))
+                user_cmts_erase(m, p);
+            if (!text.empty())
+                user_cmts_insert(m, loc, citem_cmt_t(text.c_str()));
+        }
+        save_user_cmts(func_ea, m);
+        user_cmts_free(m);
+        ++st.saves;
+    }
+
+    void apply_numforms(ea_t func_ea, const func_edits_t& e, annotation_stats_t& st)
+    {
+        user_numforms_t* m = restore_user_numforms(func_ea);
+        if (m == nullptr)
+            m = user_numforms_new();
+        for (auto& [loc, nf] : e.numforms)
+        {
+            auto p = user_numforms_find(m, loc);
+            if (p != user_numforms_end(m))
+                user_numforms_erase(m, p);
+            if (nf.has_value())
+                user_numforms_insert(m, loc, *nf);
+        }
+        save_user_numforms(func_ea, m);
+        user_numforms_free(m);
+        ++st.saves;
+    }
+
+    void apply_iflags(ea_t func_ea, const func_edits_t& e, annotation_stats_t& st)
+    {
+        user_iflags_t* m = restore_user_iflags(func_ea);
+        if (m == nullptr)
+            m = user_iflags_new();
+        for (auto& [loc, fl] : e.iflags)
+        {
+            auto p = user_iflags_find(m, loc);
+            if (p != user_iflags_end(m))
+                user_iflags_erase(m, p);
+            if (fl != 0)
+                user_iflags_insert(m, loc, fl);
+        }
+        save_user_iflags(func_ea, m);
+        user_iflags_free(m);
+        ++st.saves;
+    }
+
+    void apply_labels(ea_t func_ea, const func_edits_t& e, annotation_stats_t& st)
+    {
+        user_labels_t* m = restore_user_labels(func_ea);
+        if (m == nullptr)
+            m = user_labels_new();
+        for (auto& [num, name] : e.labels)
+        {
+            auto p = user_labels_find(m, num);
+            if (p != user_labels_end(m))
+                user_labels_erase(m, p);
+            if (!name.empty())
+                user_labels_insert(m, num, name);
+        }
+        save_user_labels(func_ea, m);
+        user_labels_free(m);
+        ++st.saves;
+    }
+
+    void apply_lvars(ea_t func_ea, const func_edits_t& e, annotation_stats_t& st)
+    {
+        lvar_uservec_t lvinf;
+        restore_user_lvar_settings(&lvinf, func_ea);
+        for (auto& [ll, edit] : e.lvars)
+        {
+            lvar_saved_info_t* info = lvinf.find_info(ll);
+            if (info == nullptr)
+            {
+                lvinf.lvvec.push_back(lvar_saved_info_t());
+                info = &lvinf.lvvec.back();
+                info->ll = ll;
+                info->flags |= LVINF_KEEP;
+            }
+            if ((edit.what & LVE_NAME) != 0)
+                info->name = edit.name;
+            if ((edit.what & LVE_TYPE) != 0)
+                info->type = edit.type;
+            if ((edit.what & LVE_CMT) != 0)
+                info->cmt = edit.cmt;
+        }
+        save_user_lvar_settings(func_ea, lvinf);
+        ++st.saves;
+    }
+
+    /// Refresh every open pseudocode view showing a committed function
+    static size_t refresh_views(const std::set<ea_t>& changed)
+    {
+        size_t n = 0;
+        pseudocode_views_t::instance().for_each([&](vdui_t* vu)
+        {
+            if (vu->cfunc == nullptr || changed.count(vu->cfunc->entry_ea) == 0)
+                return;
+            vu->refresh_view(true);
+            ++n;
+        });
+        return n;
+    }
+
+public:
+    /**
+     * @param cache Optional cfunc cache whose entries are invalidated on commit
+     */
+    explicit annotation_txn_t(cfunc_cache_t* cache = nullptr) : cache(cache)
+    {
+        // Start tracking views early so the ones opened meanwhile are refreshed
+        pseudocode_views_t::instance();
+    }
+
+    annotation_txn_t(const annotation_txn_t&) = delete;
+    annotation_txn_t& operator=(const annotation_txn_t&) = delete;
+
+    /**
+     * @brief Stage a user comment (an empty comment removes it).
+     */
+    void set_cmt(ea_t func_ea, const treeloc_t& loc, const char* cmt)
+    {
+        funcs[func_ea].cmts[loc] = cmt != nullptr ? cmt : "";
+    }
+
+    /**
+     * @brief Stage a number format for an operand.
+     */
+    void set_numform(ea_t func_ea, const operand_locator_t& loc, const number_format_t& nf)
+    {
+        funcs[func_ea].numforms[loc] = nf;
+    }
+
+    /**
+     * @brief Stage the removal of an operand's number format.
+     */
+    void del_numform(ea_t func_ea, const operand_locator_t& loc)
+    {
+        funcs[func_ea].numforms[loc] = std::nullopt;
+    }
+
+    /**
+     * @brief Stage item flags such as CIT_COLLAPSED (0 removes them).
+     */
+    void set_iflags(ea_t func_ea, const citem_locator_t& loc, int32 iflags)
+    {
+        funcs[func_ea].iflags[loc] = iflags;
+    }
+
+    /**
+     * @brief Stage a label name (an empty name restores the default).
+     */
+    void set_label(ea_t func_ea, int label_num, const char* name)
+    {
+        funcs[func_ea].labels[label_num] = name != nullptr ? name : "";
+    }
+
+    /**
+     * @brief Stage a local variable rename.
+     */
+    void rename_lvar(ea_t func_ea, const lvar_locator_t& ll, const char* name)
+    {
+        auto& e = funcs[func_ea].lvars[ll];
+        e.name = name != nullptr ? name : "";
+        e.what |= LVE_NAME;
+    }
+
+    /**
+     * @brief Stage a local variable type.
+     */
+    void set_lvar_type(ea_t func_ea, const lvar_locator_t& ll, const tinfo_t& type)
+    {
+        auto& e = funcs[func_ea].lvars[ll];
+        e.type = type;
+        e.what |= LVE_TYPE;
+    }
+
+    /**
+     * @brief Stage a local variable comment.
+     */
+    void set_lvar_cmt(ea_t func_ea, const lvar_locator_t& ll, const char* cmt)
+    {
+        auto& e = funcs[func_ea].lvars[ll];
+        e.cmt = cmt != nullptr ? cmt : "";
+        e.what |= LVE_CMT;
+    }
+
+    /// Number of staged edits
+    size_t pending() const
+    {
+        size_t n = 0;
+        for (auto& [ea, e] : funcs)
+            n += e.size();
+        return n;
+    }
+
+    /// Number of functions with staged edits
+    size_t func_count() const { return funcs.size(); }
+
+    /**
+     * @brief Discard every staged edit.
+     */
+    void rollback() { funcs.clear(); }
+
+    /**
+     * @brief Persist every staged edit.
+     *
+     * Per function, each annotation kind with edits is restored, patched and
+     * saved exactly once. The decompiler's cached cfunc is then marked dirty
+     * (and dropped from the optional cfunc_cache_t) so the next decompilation
+     * picks the changes up; open views are refreshed once each.
+     *
+     * @param flags ATX_* flags
+     * @return Commit statistics
+     */
+    annotation_stats_t commit(uint32_t flags = ATX_REFRESH)
+    {
+        annotation_stats_t st;
+        std::set<ea_t> changed;
+        for (auto& [func_ea, e] : funcs)
+        {
+            if (e.size() == 0)
+                continue;
+            if (!e.cmts.empty())
+                apply_cmts(func_ea, e, st);
+            if (!e.numforms.empty())
+                apply_numforms(func_ea, e, st);
+            if (!e.iflags.empty())
+                apply_iflags(func_ea, e, st);
+            if (!e.labels.empty())
+                apply_labels(func_ea, e, st);
+            if (!e.lvars.empty())
+                apply_lvars(func_ea, e, st);
+
+            st.edits += e.size();
+            ++st.funcs;
+            changed.insert(func_ea);
+            mark_cfunc_dirty(func_ea);
+            if (cache != nullptr)
+                cache->invalidate(func_ea);
+        }
+        funcs.clear();
+
+        if ((flags & ATX_REFRESH) != 0 && !changed.empty())
+            st.refreshed = refresh_views(changed);
+        return st;
+    }
+};
+
+}  // namespace idacpp::hexrays
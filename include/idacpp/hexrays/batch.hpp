@@ -0,0 +1,954 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Database-wide batch ctree queries
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <hexrays.hpp>
+#include <funcs.hpp>
+#include <xref.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Bounded cache of decompiled functions and their snapshots.
+ *
+ * Keeps the most recently used cfuncs alive and the most recently used
+ * pointer-free snapshots (two separate LRUs, since snapshots are much
+ * smaller), and remembers decompilation failures so they are never retried
+ * until invalidated.
+ *
+ * Entries are not tied to the database by default: call invalidate() after
+ * changing a function, or watch_changes() to have the cache drop the
+ * functions affected by edits (function bounds, renames, types, operand
+ * types, pseudocode comments and local variables) by itself.
+ */
+class cfunc_cache_t : public event_listener_t
+{
+private:
+    struct entry_t
+    {
+        cfuncptr_t cfunc;
+        std::list<ea_t>::iterator lru_pos;
+    };
+
+    struct snap_entry_t
+    {
+        ctree_snapshot_ptr_t snap;
+        std::list<ea_t>::iterator lru_pos;
+    };
+
+    size_t max_cfuncs;
+    size_t max_snapshots;
+    std::list<ea_t> lru;                                        ///< Most recently used first
+    std::unordered_map<ea_t, entry_t> cfuncs;                   ///< Live cfuncs
+    mutable std::list<ea_t> snap_lru;                           ///< Most recently used first
+    std::unordered_map<ea_t, snap_entry_t> snapshots;           ///< Detached snapshots
+    std::unordered_map<ea_t, qstring> failures;                 ///< Failed functions and reasons
+    bool watching = false;
+
+    static ssize_t idaapi hexrays_cb(void* ud, hexrays_event_t event, va_list va)
+    {
+        auto self = (cfunc_cache_t*)ud;
+        switch (event)
+        {
+            case hxe_cmt_changed:
+            {
+                cfunc_t* cfunc = va_arg(va, cfunc_t*);
+                if (cfunc != nullptr)
+                    self->invalidate(cfunc->entry_ea);
+                break;
+            }
+            case lxe_lvar_name_changed:
+            case lxe_lvar_type_changed:
+            case lxe_lvar_cmt_changed:
+            case lxe_lvar_mapping_changed:
+            {
+                vdui_t* vu = va_arg(va, vdui_t*);
+                if (vu->cfunc != nullptr)
+                    self->invalidate(vu->cfunc->entry_ea);
+                break;
+            }
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    /// Drop the function containing an address
+    void invalidate_at(ea_t ea)
+    {
+        func_t* pfn = get_func(ea);
+        if (pfn != nullptr)
+            invalidate(pfn->start_ea);
+    }
+
+    /// Drop the function containing an address and every function referring to it
+    void invalidate_users(ea_t ea)
+    {
+        invalidate_at(ea);
+        xrefblk_t xb;
+        for (bool ok = xb.first_to(ea, XREF_FAR); ok; ok = xb.next_to())
+            invalidate_at(xb.from);
+    }
+
+public:
+    size_t hits = 0;      ///< Requests served from the cache
+    size_t misses = 0;    ///< Requests that had to decompile
+
+    /**
+     * @brief Construct the cache.
+     *
+     * @param max_cfuncs Maximum number of live cfuncs to keep
+     * @param max_snapshots Maximum number of snapshots to keep
+     */
+    explicit cfunc_cache_t(size_t max_cfuncs = 64, size_t max_snapshots = 4096)
+        : max_cfuncs(std::max<size_t>(max_cfuncs, 1)), max_snapshots(std::max<size_t>(max_snapshots, 1))
+    {
+    }
+
+    ~cfunc_cache_t() override
+    {
+        unwatch_changes();
+    }
+
+    cfunc_cache_t(const cfunc_cache_t&) = delete;
+    cfunc_cache_t& operator=(const cfunc_cache_t&) = delete;
+
+    /**
+     * @brief Drop cached entries automatically when their function changes.
+     *
+     * Hooks IDB and decompiler notifications: function bound changes and
+     * deletions drop the function, renames and type changes drop the
+     * function at the address and every function referring to it, and local
+     * type changes or closing the database drop everything.
+     *
+     * @return true if the notifications are hooked
+     */
+    bool watch_changes()
+    {
+        if (!watching)
+        {
+            watching = hook_event_listener(HT_IDB, this);
+            if (watching)
+                install_hexrays_callback(hexrays_cb, this);
+        }
+        return watching;
+    }
+
+    /// true while watch_changes() is in effect
+    bool is_watching() const { return watching; }
+
+    /**
+     * @brief Stop dropping entries automatically.
+     */
+    void unwatch_changes()
+    {
+        if (!watching)
+            return;
+        unhook_event_listener(HT_IDB, this);
+        remove_hexrays_callback(hexrays_cb, this);
+        watching = false;
+    }
+
+    /**
+     * @brief IDB notification handler (see watch_changes()).
+     */
+    ssize_t idaapi on_event(ssize_t code, va_list va) override
+    {
+        switch (code)
+        {
+            case idb_event::func_updated:
+            case idb_event::deleting_func:
+            case idb_event::set_func_start:
+            case idb_event::set_func_end:
+            case idb_event::func_tail_appended:
+            case idb_event::func_tail_deleted:
+                invalidate(va_arg(va, func_t*)->start_ea);
+                break;
+            case idb_event::renamed:
+            case idb_event::ti_changed:
+                invalidate_users(va_arg(va, ea_t));
+                break;
+            case idb_event::op_type_changed:
+                invalidate_at(va_arg(va, ea_t));
+                break;
+            case idb_event::local_types_changed:
+            case idb_event::closebase:
+                clear();
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Get a decompiled function, decompiling it on a miss.
+     *
+     * @param pfn Function to decompile
+     * @param decomp_flags DECOMP_* flags passed to decompile_func()
+     * @param from_cache Optional output, set to true on a cache hit
+     * @return Decompiled function, or an empty pointer if decompilation failed now or earlier
+     */
+    cfuncptr_t get(func_t* pfn, int decomp_flags = DECOMP_NO_WAIT, bool* from_cache = nullptr)
+    {
+        ea_t ea = pfn->start_ea;
+        if (from_cache != nullptr)
+            *from_cache = false;
+
+        if (has_failed(ea))
+            return cfuncptr_t();
+
+        auto p = cfuncs.find(ea);
+        if (p != std::end(cfuncs))
+        {
+            ++hits;
+            lru.splice(lru.begin(), lru, p->second.lru_pos);
+            if (from_cache != nullptr)
+                *from_cache = true;
+            return p->second.cfunc;
+        }
+
+        ++misses;
+        hexrays_failure_t hf;
+        cfuncptr_t cfunc = decompile_func(pfn, &hf, decomp_flags);
+        if (cfunc == nullptr)
+        {
+            failures[ea] = hf.desc();
+            return cfunc;
+        }
+
+        lru.push_front(ea);
+        cfuncs[ea] = entry_t{cfunc, lru.begin()};
+        while (cfuncs.size() > max_cfuncs)
+        {
+            cfuncs.erase(lru.back());
+            lru.pop_back();
+        }
+        return cfunc;
+    }
+
+    /**
+     * @brief Get the cached snapshot of a function, if any.
+     *
+     * @param func_ea Function entry address
+     * @return Snapshot, or nullptr if none was recorded
+     */
+    ctree_snapshot_ptr_t get_snapshot(ea_t func_ea) const
+    {
+        auto p = snapshots.find(func_ea);
+        if (p == std::end(snapshots))
+            return nullptr;
+        snap_lru.splice(snap_lru.begin(), snap_lru, p->second.lru_pos);
+        return p->second.snap;
+    }
+
+    /**
+     * @brief Get the snapshot of a function, decompiling it if needed.
+     *
+     * @param pfn Function
+     * @param decomp_flags DECOMP_* flags used on a miss
+     * @return Snapshot, or nullptr if decompilation failed
+     */
+    ctree_snapshot_ptr_t get_snapshot(func_t* pfn, int decomp_flags = DECOMP_NO_WAIT)
+    {
+        auto snap = get_snapshot(pfn->start_ea);
+        if (snap != nullptr)
+            return snap;
+
+        cfuncptr_t cfunc = get(pfn, decomp_flags);
+        if (cfunc == nullptr)
+            return nullptr;
+
+        snap = make_snapshot(cfunc);
+        put_snapshot(pfn->start_ea, snap);
+        return snap;
+    }
+
+    /**
+     * @brief Record a snapshot for a function, evicting the least recently used beyond the limit.
+     */
+    void put_snapshot(ea_t func_ea, ctree_snapshot_ptr_t snap)
+    {
+        auto p = snapshots.find(func_ea);
+        if (p != std::end(snapshots))
+        {
+            p->second.snap = std::move(snap);
+            snap_lru.splice(snap_lru.begin(), snap_lru, p->second.lru_pos);
+            return;
+        }
+        snap_lru.push_front(func_ea);
+        snapshots[func_ea] = snap_entry_t{std::move(snap), snap_lru.begin()};
+        while (snapshots.size() > max_snapshots)
+        {
+            snapshots.erase(snap_lru.back());
+            snap_lru.pop_back();
+        }
+    }
+
+    /// true if a snapshot of the function is cached (does not touch the LRU order)
+    bool has_snapshot(ea_t func_ea) const
+    {
+        return snapshots.find(func_ea) != std::end(snapshots);
+    }
+
+    /// Number of cached snapshots
+    size_t snapshot_count() const { return snapshots.size(); }
+
+    /// Maximum number of cached snapshots
+    size_t snapshot_capacity() const { return max_snapshots; }
+
+    /**
+     * @brief Check whether a function previously failed to decompile.
+     */
+    bool has_failed(ea_t func_ea) const
+    {
+        return failures.find(func_ea) != std::end(failures);
+    }
+
+    /**
+     * @brief Get the recorded failure reason for a function.
+     *
+     * @return Failure description, or nullptr if the function did not fail
+     */
+    const char* failure_of(ea_t func_ea) const
+    {
+        auto p = failures.find(func_ea);
+        return p == std::end(failures) ? nullptr : p->second.c_str();
+    }
+
+    /// Number of functions known to fail
+    size_t failed_count() const { return failures.size(); }
+
+    /**
+     * @brief Forget everything cached for a function (e.g. after it changed).
+     */
+    void invalidate(ea_t func_ea)
+    {
+        auto p = cfuncs.find(func_ea);
+        if (p != std::end(cfuncs))
+        {
+            lru.erase(p->second.lru_pos);
+            cfuncs.erase(p);
+        }
+        auto s = snapshots.find(func_ea);
+        if (s != std::end(snapshots))
+        {
+            snap_lru.erase(s->second.lru_pos);
+            snapshots.erase(s);
+        }
+        failures.erase(func_ea);
+    }
+
+    /**
+     * @brief Forget everything.
+     */
+    void clear()
+    {
+        lru.clear();
+        cfuncs.clear();
+        snap_lru.clear();
+        snapshots.clear();
+        failures.clear();
+        hits = misses = 0;
+    }
+};
+
+//----------------------------------------------------------------------------------
+/// Function iteration orders for batch queries
+enum batch_order_t
+{
+    BQO_ADDRESS,         ///< Ascending entry address
+    BQO_SIZE_ASC,        ///< Smallest functions first
+    BQO_SIZE_DESC,       ///< Largest functions first
+    BQO_CALLEES_FIRST,   ///< Call-graph post-order: callees before their callers
+};
+
+// Batch query flags:
+#define BQF_NONE          0x00  ///< No special flags
+#define BQF_SKIP_LIBS     0x01  ///< Skip library functions
+#define BQF_SKIP_THUNKS   0x02  ///< Skip thunk functions
+#define BQF_NO_WAITBOX    0x04  ///< Do not show a wait box (progress callback only)
+#define BQF_SNAPSHOTS     0x08  ///< Record a snapshot of every decompiled function
+
+/**
+ * @brief Collect functions in a given order.
+ *
+ * @param order One of BQO_*
+ * @param flags BQF_* flags (only the skip flags are used)
+ * @return Entry addresses of the selected functions
+ */
+inline std::vector<ea_t> collect_batch_funcs(batch_order_t order, uint32_t flags = BQF_NONE)
+{
+    std::vector<func_t*> funcs;
+    size_t qty = get_func_qty();
+    funcs.reserve(qty);
+    for (size_t i = 0; i < qty; ++i)
+    {
+        func_t* pfn = getn_func(i);
+        if (pfn == nullptr)
+            continue;
+        if ((flags & BQF_SKIP_LIBS) != 0 && (pfn->flags & FUNC_LIB) != 0)
+            continue;
+        if ((flags & BQF_SKIP_THUNKS) != 0 && (pfn->flags & FUNC_THUNK) != 0)
+            continue;
+        funcs.push_back(pfn);
+    }
+
+    std::vector<ea_t> result;
+    result.reserve(funcs.size());
+
+    if (order == BQO_SIZE_ASC || order == BQO_SIZE_DESC)
+    {
+        std::vector<std::pair<asize_t, ea_t>> sized;
+        sized.reserve(funcs.size());
+        for (auto pfn : funcs)
+            sized.emplace_back(calc_func_size(pfn), pfn->start_ea);
+        if (order == BQO_SIZE_ASC)
+            std::stable_sort(sized.begin(), sized.end(), [](auto& a, auto& b) { return a.first < b.first; });
+        else
+            std::stable_sort(sized.begin(), sized.end(), [](auto& a, auto& b) { return a.first > b.first; });
+        for (auto& [size, ea] : sized)
+            result.push_back(ea);
+        return result;
+    }
+
+    if (order != BQO_CALLEES_FIRST)
+    {
+        for (auto pfn : funcs)
+            result.push_back(pfn->start_ea);
+        return result;
+    }
+
+    // Build callee lists from code cross-references
+    std::unordered_map<ea_t, size_t> index;
+    for (size_t i = 0; i < funcs.size(); ++i)
+        index[funcs[i]->start_ea] = i;
+
+    std::vector<std::vector<size_t>> callees(funcs.size());
+    for (size_t i = 0; i < funcs.size(); ++i)
+    {
+        func_item_iterator_t fii;
+        for (bool ok = fii.set(funcs[i]); ok; ok = fii.next_code())
+        {
+            xrefblk_t xb;
+            for (bool x = xb.first_from(fii.current(), XREF_FAR); x; x = xb.next_from())
+            {
+                if (!xb.iscode || (xb.type != fl_CN && xb.type != fl_CF))
+                    continue;
+                func_t* callee = get_func(xb.to);
+                if (callee == nullptr)
+                    continue;
+                auto p = index.find(callee->start_ea);
+                if (p != std::end(index) && p->second != i)
+                    callees[i].push_back(p->second);
+            }
+        }
+    }
+
+    // Iterative post-order DFS
+    std::vector<uint8_t> state(funcs.size(), 0);  // 0=new, 1=on stack, 2=done
+    std::vector<std::pair<size_t, size_t>> stack;
+    for (size_t root = 0; root < funcs.size(); ++root)
+    {
+        if (state[root] != 0)
+            continue;
+        stack.emplace_back(root, 0);
+        state[root] = 1;
+        while (!stack.empty())
+        {
+            auto& [node, next] = stack.back();
+            if (next < callees[node].size())
+            {
+                size_t callee = callees[node][next++];
+                if (state[callee] == 0)
+                {
+                    state[callee] = 1;
+                    stack.emplace_back(callee, 0);
+                }
+                continue;
+            }
+            state[node] = 2;
+            result.push_back(funcs[node]->start_ea);
+            stack.pop_back();
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Rate-limited progress and cancellation checker.
+ *
+ * Polling user_cancelled() or repainting the wait box for every function is
+ * expensive; this helper only reports a tick once per interval.
+ */
+class progress_ticker_t
+{
+private:
+    using clock_t_ = std::chrono::steady_clock;
+    clock_t_::duration interval;
+    clock_t_::time_point next;
+
+public:
+    /**
+     * @param interval_ms Minimum delay between two ticks
+     */
+    explicit progress_ticker_t(uint32_t interval_ms = 250)
+        : interval(std::chrono::milliseconds(interval_ms)), next(clock_t_::now()) {}
+
+    /**
+     * @brief Check whether the interval elapsed since the last tick.
+     */
+    bool tick()
+    {
+        auto now = clock_t_::now();
+        if (now < next)
+            return false;
+        next = now + interval;
+        return true;
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief A single batch query match.
+ *
+ * The cfunc and expr pointers are only valid during the sink callback.
+ */
+struct batch_match_t
+{
+    ea_t func_ea = BADADDR;    ///< Function containing the match
+    ea_t ea = BADADDR;         ///< Address of the matched expression
+    ctype_t op = cot_empty;    ///< Type of the matched expression
+    cfunc_t* cfunc = nullptr;  ///< Decompiled function
+    cexpr_t* expr = nullptr;   ///< Matched expression
+};
+
+/**
+ * @brief Batch query counters, also passed to progress callbacks.
+ */
+struct batch_stats_t
+{
+    size_t total = 0;          ///< Functions selected
+    size_t processed = 0;      ///< Functions handled so far
+    size_t decompiled = 0;     ///< Functions decompiled by this run
+    size_t cached = 0;         ///< Functions served from the cfunc cache
+    size_t failed = 0;         ///< Functions that failed to decompile in this run
+    size_t skipped_failed = 0; ///< Functions skipped because they failed earlier
+    size_t pruned = 0;         ///< Functions skipped because their snapshot cannot match
+    size_t matches = 0;        ///< Matches reported to the sink
+    bool cancelled = false;    ///< Stopped by the user, progress callback or sink
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Destination for streamed batch query results.
+ */
+class batch_sink_t
+{
+public:
+    virtual ~batch_sink_t() = default;
+
+    /**
+     * @brief Receive a match.
+     *
+     * @return true to continue, false to stop the query
+     */
+    virtual bool on_match(const batch_match_t& m) = 0;
+
+    /**
+     * @brief Called after each processed function.
+     */
+    virtual void on_func_done(ea_t func_ea, size_t nmatches) {}
+
+    /**
+     * @brief Called once when the query ends.
+     */
+    virtual void on_finish(const batch_stats_t& stats) {}
+};
+
+/**
+ * @brief Sink that forwards matches to a callback.
+ */
+class callback_sink_t : public batch_sink_t
+{
+    std::function<bool(const batch_match_t&)> cb;
+
+public:
+    explicit callback_sink_t(std::function<bool(const batch_match_t&)> cb) : cb(std::move(cb)) {}
+
+    bool on_match(const batch_match_t& m) override
+    {
+        return cb(m);
+    }
+};
+
+/**
+ * @brief Get the tag-free text of a matched expression.
+ */
+inline qstring batch_match_text(const batch_match_t& m)
+{
+    qstring text, clean;
+    m.expr->print1(&text, m.cfunc);
+    tag_remove(&clean, text.c_str());
+    return clean;
+}
+
+/**
+ * @brief Sink that writes one tab-separated line per match.
+ *
+ * Columns: function address, match address, item type, expression text.
+ */
+class file_sink_t : public batch_sink_t
+{
+    FILE* fp;
+    bool owned;
+
+public:
+    /**
+     * @brief Write to an already open file (not closed by the sink).
+     */
+    explicit file_sink_t(FILE* fp) : fp(fp), owned(false) {}
+
+    /**
+     * @brief Create and own an output file.
+     */
+    explicit file_sink_t(const char* path) : fp(qfopen(path, "w")), owned(true) {}
+
+    ~file_sink_t() override
+    {
+        if (owned && fp != nullptr)
+            qfclose(fp);
+    }
+
+    file_sink_t(const file_sink_t&) = delete;
+    file_sink_t& operator=(const file_sink_t&) = delete;
+
+    /// true if the output file is open
+    bool is_open() const { return fp != nullptr; }
+
+    bool on_match(const batch_match_t& m) override
+    {
+        if (fp == nullptr)
+            return false;
+        qfprintf(fp, "%a\t%a\t%s\t%s\n", m.func_ea, m.ea, get_ctype_name(m.op), batch_match_text(m).c_str());
+        return true;
+    }
+};
+
+/**
+ * @brief Sink that collects matches and shows them in a chooser.
+ */
+class chooser_sink_t : public batch_sink_t
+{
+public:
+    /// Collected chooser row
+    struct row_t
+    {
+        ea_t func_ea;
+        ea_t ea;
+        ctype_t op;
+        qstring text;
+    };
+    using rows_t = std::vector<row_t>;
+
+private:
+    std::shared_ptr<rows_t> rows = std::make_shared<rows_t>();
+
+    class chooser_impl_t : public chooser_t
+    {
+        std::shared_ptr<rows_t> rows;
+
+    public:
+        chooser_impl_t(std::shared_ptr<rows_t> rows, const char* title)
+            : chooser_t(0, qnumber(widths), widths, header, title), rows(std::move(rows)) {}
+
+        static constexpr int widths[] = { 16 | CHCOL_EA, 16 | CHCOL_EA, 10, 60 };
+        static constexpr const char* const header[] = { "Function", "Address", "Type", "Expression" };
+
+        size_t idaapi get_count() const override { return rows->size(); }
+
+        void idaapi get_row(qstrvec_t* cols, int*, chooser_item_attrs_t*, size_t n) const override
+        {
+            const auto& r = (*rows)[n];
+            qstring fname;
+            if (get_func_name(&fname, r.func_ea) <= 0)
+                fname.sprnt("%a", r.func_ea);
+            (*cols)[0] = fname;
+            (*cols)[1].sprnt("%a", r.ea);
+            (*cols)[2] = get_ctype_name(r.op);
+            (*cols)[3] = r.text;
+        }
+
+        ea_t idaapi get_ea(size_t n) const override { return (*rows)[n].ea; }
+    };
+
+public:
+    bool on_match(const batch_match_t& m) override
+    {
+        rows->push_back(row_t{m.func_ea, m.ea, m.op, batch_match_text(m)});
+        return true;
+    }
+
+    /// Collected rows
+    const rows_t& get_rows() const { return *rows; }
+
+    /**
+     * @brief Show the collected matches in a non-modal chooser.
+     *
+     * @param title Chooser title
+     */
+    void show(const char* title = "Batch query results")
+    {
+        (new chooser_impl_t(rows, title))->choose();
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Database-wide ctree query engine.
+ *
+ * Iterates functions in a chosen order, reuses a cfunc_cache_t across runs,
+ * reports rate-limited progress with cancellation, streams matches to a sink
+ * and never retries functions that already failed to decompile.
+ *
+ * @example
+ * @code
+ * cfunc_cache_t cache;
+ * batch_query_t q(&cache);
+ * q.order = BQO_SIZE_ASC;
+ * q.ops.set(cot_call);   // only calls; functions without calls are pruned by snapshot
+ * chooser_sink_t sink;
+ * q.find_expr([](cexpr_t* e) { return e->x->op == cot_helper; }, sink);
+ * sink.show("Helper calls");
+ * @endcode
+ */
+class batch_query_t
+{
+private:
+    cfunc_cache_t own_cache;
+    cfunc_cache_t* cache;
+
+    /**
+     * @brief Drive the per-function loop: ordering, progress, cancellation.
+     *
+     * @param per_func Handler for one function; return false to stop
+     * @param sink Optional sink notified of per-function completion and the final stats
+     */
+    batch_stats_t run(
+        const std::function<bool(ea_t, batch_stats_t&)>& per_func,
+        batch_sink_t* sink)
+    {
+        batch_stats_t st;
+        std::vector<ea_t> work = funcs.empty() ? collect_batch_funcs(order, flags) : funcs;
+        st.total = work.size();
+
+        bool waitbox = (flags & BQF_NO_WAITBOX) == 0;
+        if (waitbox)
+            show_wait_box("Running batch query...");
+
+        progress_ticker_t ticker(progress_ms);
+        for (ea_t func_ea : work)
+        {
+            if (ticker.tick())
+            {
+                if (waitbox)
+                {
+                    replace_wait_box("Batch query: %zu/%zu functions, %zu matches",
+                                     st.processed, st.total, st.matches);
+                    if (user_cancelled())
+                        st.cancelled = true;
+                }
+                if (on_progress && !on_progress(st))
+                    st.cancelled = true;
+                if (st.cancelled)
+                    break;
+            }
+
+            ++st.processed;
+            if (cache->has_failed(func_ea))
+            {
+                ++st.skipped_failed;
+                continue;
+            }
+
+            size_t before = st.matches;
+            bool go_on = per_func(func_ea, st);
+            if (sink != nullptr)
+                sink->on_func_done(func_ea, st.matches - before);
+            if (!go_on)
+            {
+                st.cancelled = true;
+                break;
+            }
+        }
+
+        if (waitbox)
+            hide_wait_box();
+        if (sink != nullptr)
+            sink->on_finish(st);
+        return st;
+    }
+
+    /// Decompile (or fetch from the cache) one function, updating the counters
+    cfuncptr_t get_cfunc(ea_t func_ea, batch_stats_t& st)
+    {
+        func_t* pfn = get_func(func_ea);
+        if (pfn == nullptr)
+            return cfuncptr_t();
+
+        bool from_cache;
+        cfuncptr_t cfunc = cache->get(pfn, decomp_flags, &from_cache);
+        if (cfunc == nullptr)
+        {
+            ++st.failed;
+            return cfunc;
+        }
+        ++(from_cache ? st.cached : st.decompiled);
+
+        if ((flags & BQF_SNAPSHOTS) != 0 && cache->get_snapshot(func_ea) == nullptr)
+            cache->put_snapshot(func_ea, make_snapshot(cfunc));
+        return cfunc;
+    }
+
+public:
+    batch_order_t order = BQO_ADDRESS;        ///< Function iteration order
+    uint32_t flags = BQF_NONE;                ///< BQF_* flags
+    int decomp_flags = DECOMP_NO_WAIT;        ///< Flags passed to decompile_func()
+    uint32_t progress_ms = 250;               ///< Minimum delay between progress reports
+    ctype_set_t ops;                          ///< Item types of interest (empty means all)
+    std::vector<ea_t> funcs;                  ///< Explicit function list (empty means all, in `order`)
+
+    /// Progress callback: return false to cancel
+    std::function<bool(const batch_stats_t&)> on_progress;
+
+    /**
+     * @brief Construct a query engine.
+     *
+     * @param cache Shared cache to reuse across queries (a private one is used if nullptr)
+     */
+    explicit batch_query_t(cfunc_cache_t* cache = nullptr)
+        : cache(cache != nullptr ? cache : &own_cache) {}
+
+    /// The cache used by this engine
+    cfunc_cache_t& get_cache() { return *cache; }
+
+    /**
+     * @brief Run a per-function callback over every selected function.
+     *
+     * @param cb Callback invoked with each decompiled function; return false to stop
+     * @param sink Optional sink notified of per-function completion and the final stats
+     * @return Run statistics
+     */
+    batch_stats_t for_each_cfunc(
+        std::function<bool(const cfuncptr_t&, batch_stats_t&)> cb,
+        batch_sink_t* sink = nullptr)
+    {
+        return run([&](ea_t func_ea, batch_stats_t& st)
+        {
+            // A cached snapshot lacking every op of interest cannot match
+            if (ops.any())
+            {
+                auto snap = cache->get_snapshot(func_ea);
+                if (snap != nullptr && (snap->ops & ops).none())
+                {
+                    ++st.pruned;
+                    return true;
+                }
+            }
+
+            cfuncptr_t cfunc = get_cfunc(func_ea, st);
+            return cfunc == nullptr || cb(cfunc, st);
+        }, sink);
+    }
+
+    /**
+     * @brief Run a per-function callback over the snapshot of every selected function.
+     *
+     * Cached snapshots are used without decompiling. Other functions are
+     * decompiled and snapshotted; the snapshot is kept in the cache only with
+     * BQF_SNAPSHOTS, otherwise it is dropped after the callback.
+     *
+     * @param cb Callback invoked with each snapshot; return false to stop
+     * @param sink Optional sink notified of per-function completion and the final stats
+     * @return Run statistics
+     */
+    batch_stats_t for_each_snapshot(
+        std::function<bool(const ctree_snapshot_t&, batch_stats_t&)> cb,
+        batch_sink_t* sink = nullptr)
+    {
+        return run([&](ea_t func_ea, batch_stats_t& st)
+        {
+            auto snap = cache->get_snapshot(func_ea);
+            if (snap != nullptr)
+            {
+                ++st.cached;
+            }
+            else
+            {
+                cfuncptr_t cfunc = get_cfunc(func_ea, st);
+                if (cfunc == nullptr)
+                    return true;
+                snap = cache->get_snapshot(func_ea);
+                if (snap == nullptr)
+                    snap = make_snapshot(cfunc);
+            }
+
+            if (ops.any() && (snap->ops & ops).none())
+            {
+                ++st.pruned;
+                return true;
+            }
+            return cb(*snap, st);
+        }, sink);
+    }
+
+    /**
+     * @brief Stream every expression matching a predicate to a sink.
+     *
+     * @param pred Predicate invoked for each expression whose type is in `ops`
+     * @param sink Result sink
+     * @param cv_flags Visitor flags (default: CV_FAST)
+     * @return Run statistics
+     */
+    batch_stats_t find_expr(
+        std::function<bool(cexpr_t*)> pred,
+        batch_sink_t& sink,
+        int cv_flags = CV_FAST)
+    {
+        return for_each_cfunc([&](const cfuncptr_t& cfunc, batch_stats_t& st)
+        {
+            bool go_on = true;
+            hexrays::find_expr(cfunc, [&](cexpr_t* e) -> int
+            {
+                if (ops.any() && !ops.test(e->op))
+                    return 0;
+                if (!pred(e))
+                    return 0;
+                ++st.matches;
+                go_on = sink.on_match(batch_match_t{cfunc->entry_ea, e->ea, e->op, cfunc, e});
+                return go_on ? 0 : 1;
+            }, cv_flags);
+            return go_on;
+        }, &sink);
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,383 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - CSR call-graph extraction from ctrees
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <hexrays.hpp>
+#include <funcs.hpp>
+#include <xref.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/batch.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Call edge kinds
+enum call_edge_kind_t : uint8_t
+{
+    CGE_DIRECT,       ///< Call to a function entry
+    CGE_IMPORT,       ///< Call to an address that is not a function entry (import, IAT slot, external symbol)
+    CGE_INDIRECT,     ///< Computed call, one edge per resolved target
+    CGE_UNRESOLVED,   ///< Computed call without known targets (only with CGF_UNRESOLVED)
+    CGE_HELPER,       ///< Call to a decompiler helper (only with CGF_HELPERS)
+};
+
+// Call graph extraction flags:
+#define CGF_NONE          0x00  ///< No special flags
+#define CGF_UNRESOLVED    0x01  ///< Keep indirect calls without known targets (target = BAD_NODE_ID)
+#define CGF_HELPERS       0x02  ///< Keep calls to helpers/intrinsics (target = BAD_NODE_ID)
+
+// Vertex flags:
+#define CGV_FUNC          0x01  ///< The vertex is a function entry
+#define CGV_EXTERN        0x02  ///< The vertex is not a function entry (import or external address)
+#define CGV_PROCESSED     0x04  ///< The function's calls were extracted
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Caller -> callee graph in compressed sparse row form.
+ *
+ * Vertices are sorted by address. The outgoing edges of vertex v are the edge
+ * indexes [row_start[v], row_start[v + 1]), in call order within the caller.
+ * Edge attributes are parallel columns indexed by edge.
+ *
+ * `edge_node` is the cot_call node in the caller's ctree_snapshot_t, so the
+ * argument expressions can be recovered from a (cached) snapshot.
+ */
+class call_graph_t
+{
+public:
+    std::vector<ea_t> vertices;            ///< Vertex address, sorted
+    std::vector<uint8_t> vertex_flags;     ///< CGV_* flags per vertex
+    std::vector<uint32_t> row_start;       ///< First edge of each vertex (size = vertex_count() + 1)
+    std::vector<node_id_t> edge_to;        ///< Target vertex, or BAD_NODE_ID
+    std::vector<ea_t> edge_ea;             ///< Address of the call
+    std::vector<node_id_t> edge_node;      ///< cot_call node in the caller's snapshot
+    std::vector<uint16_t> edge_nargs;      ///< Number of call arguments
+    std::vector<uint8_t> edge_kind;        ///< call_edge_kind_t
+
+    /// Number of vertices
+    size_t vertex_count() const { return vertices.size(); }
+
+    /// Number of edges
+    size_t edge_count() const { return edge_to.size(); }
+
+    /**
+     * @brief Find the vertex of an address in O(log n).
+     *
+     * @return Vertex, or BAD_NODE_ID if the address is not in the graph
+     */
+    node_id_t find_vertex(ea_t ea) const
+    {
+        auto p = std::lower_bound(vertices.begin(), vertices.end(), ea);
+        return (p != vertices.end() && *p == ea) ? node_id_t(p - vertices.begin()) : BAD_NODE_ID;
+    }
+
+    /// First outgoing edge of a vertex
+    uint32_t edges_begin(node_id_t v) const { return row_start[v]; }
+
+    /// One past the last outgoing edge of a vertex
+    uint32_t edges_end(node_id_t v) const { return row_start[v + 1]; }
+
+    /**
+     * @brief Get the callee vertices of a vertex (one entry per edge).
+     */
+    std::span<const node_id_t> callees(node_id_t v) const
+    {
+        return std::span<const node_id_t>(edge_to.data() + row_start[v], row_start[v + 1] - row_start[v]);
+    }
+
+    /**
+     * @brief Get the incoming edges of every vertex.
+     *
+     * @param rev_start Output row offsets (size = vertex_count() + 1)
+     * @param rev_edges Output edge indexes grouped by target vertex
+     */
+    void build_reverse(std::vector<uint32_t>& rev_start, std::vector<uint32_t>& rev_edges) const
+    {
+        rev_start.assign(vertex_count() + 1, 0);
+        for (auto to : edge_to)
+            if (to != BAD_NODE_ID)
+                ++rev_start[to + 1];
+        for (size_t i = 1; i < rev_start.size(); ++i)
+            rev_start[i] += rev_start[i - 1];
+
+        rev_edges.resize(rev_start.back());
+        std::vector<uint32_t> fill(rev_start.begin(), rev_start.end() - 1);
+        for (uint32_t e = 0; e < edge_to.size(); ++e)
+            if (edge_to[e] != BAD_NODE_ID)
+                rev_edges[fill[edge_to[e]]++] = e;
+    }
+
+    /**
+     * @brief Get the caller vertex of an edge in O(log n).
+     */
+    node_id_t edge_from(uint32_t e) const
+    {
+        auto p = std::upper_bound(row_start.begin(), row_start.end(), e);
+        return node_id_t((p - row_start.begin()) - 1);
+    }
+
+    /**
+     * @brief Remove all vertices and edges.
+     */
+    void clear()
+    {
+        vertices.clear();
+        vertex_flags.clear();
+        row_start.clear();
+        edge_to.clear();
+        edge_ea.clear();
+        edge_node.clear();
+        edge_nargs.clear();
+        edge_kind.clear();
+    }
+
+    /**
+     * @brief Approximate heap memory used by the graph, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return vertices.capacity() * sizeof(ea_t)
+             + vertex_flags.capacity() * sizeof(uint8_t)
+             + row_start.capacity() * sizeof(uint32_t)
+             + edge_to.capacity() * sizeof(node_id_t)
+             + edge_ea.capacity() * sizeof(ea_t)
+             + edge_node.capacity() * sizeof(node_id_t)
+             + edge_nargs.capacity() * sizeof(uint16_t)
+             + edge_kind.capacity() * sizeof(uint8_t);
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Streams the cot_call sites of snapshots into a call_graph_t.
+ *
+ * Only the flat edge columns grow while functions are added; snapshots and
+ * cfuncs are not retained. finish() sorts the vertices and groups the edges
+ * by caller.
+ */
+class call_graph_builder_t
+{
+private:
+    uint32_t flags;
+    call_graph_t& g;
+    std::unordered_map<ea_t, node_id_t> vertex_ids;   ///< Provisional vertex ids
+    std::vector<node_id_t> edge_from;                 ///< Provisional caller of each edge
+    std::vector<ea_t> resolved;
+
+    node_id_t vertex_of(ea_t ea, uint8_t vflags)
+    {
+        auto [p, inserted] = vertex_ids.emplace(ea, node_id_t(g.vertices.size()));
+        if (inserted)
+        {
+            g.vertices.push_back(ea);
+            g.vertex_flags.push_back(vflags);
+        }
+        else
+        {
+            g.vertex_flags[p->second] |= vflags;
+        }
+        return p->second;
+    }
+
+    static bool is_func_entry(ea_t ea)
+    {
+        func_t* pfn = get_func(ea);
+        return pfn != nullptr && pfn->start_ea == ea;
+    }
+
+    void add_edge(node_id_t from, node_id_t to, ea_t ea, node_id_t node, uint64_t nargs, call_edge_kind_t kind)
+    {
+        edge_from.push_back(from);
+        g.edge_to.push_back(to);
+        g.edge_ea.push_back(ea);
+        g.edge_node.push_back(node);
+        g.edge_nargs.push_back(uint16_t(std::min<uint64_t>(nargs, UINT16_MAX)));
+        g.edge_kind.push_back(uint8_t(kind));
+    }
+
+    /// Targets of a computed call known to the database (code call xrefs to function entries)
+    void resolve_targets(ea_t call_ea)
+    {
+        resolved.clear();
+        xrefblk_t xb;
+        for (bool ok = xb.first_from(call_ea, XREF_FAR); ok; ok = xb.next_from())
+        {
+            if (xb.iscode && (xb.type == fl_CN || xb.type == fl_CF) && is_func_entry(xb.to))
+                resolved.push_back(xb.to);
+        }
+    }
+
+public:
+    /**
+     * @param g Graph to fill (cleared)
+     * @param flags CGF_* flags
+     */
+    explicit call_graph_builder_t(call_graph_t& g, uint32_t flags = CGF_NONE) : flags(flags), g(g)
+    {
+        g.clear();
+    }
+
+    /**
+     * @brief Extract the calls of one function.
+     *
+     * @param snap Snapshot of the caller (items are not needed)
+     */
+    void add(const ctree_snapshot_t& snap)
+    {
+        node_id_t from = vertex_of(snap.func_ea, CGV_FUNC | CGV_PROCESSED);
+        for (node_id_t i = 0; i < snap.size(); ++i)
+        {
+            if (snap.op[i] != cot_call)
+                continue;
+
+            // The callee expression is the first child; look through casts
+            node_id_t c = snap.first_child(i);
+            while (c != BAD_NODE_ID && snap.op[c] == cot_cast)
+                c = snap.first_child(c);
+            if (c == BAD_NODE_ID)
+                continue;
+
+            ea_t call_ea = snap.ea[i];
+            uint64_t nargs = snap.aux[i];
+            switch (snap.op[c])
+            {
+                case cot_obj:
+                {
+                    ea_t target = ea_t(snap.aux[c]);
+                    if (is_func_entry(target))
+                        add_edge(from, vertex_of(target, CGV_FUNC), call_ea, i, nargs, CGE_DIRECT);
+                    else
+                        add_edge(from, vertex_of(target, CGV_EXTERN), call_ea, i, nargs, CGE_IMPORT);
+                    break;
+                }
+                case cot_helper:
+                    if ((flags & CGF_HELPERS) != 0)
+                        add_edge(from, BAD_NODE_ID, call_ea, i, nargs, CGE_HELPER);
+                    break;
+                default:
+                    resolve_targets(call_ea);
+                    for (ea_t target : resolved)
+                        add_edge(from, vertex_of(target, CGV_FUNC), call_ea, i, nargs, CGE_INDIRECT);
+                    if (resolved.empty() && (flags & CGF_UNRESOLVED) != 0)
+                        add_edge(from, BAD_NODE_ID, call_ea, i, nargs, CGE_UNRESOLVED);
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @brief Sort vertices by address and lay the edges out in CSR order.
+     */
+    void finish()
+    {
+        size_t nv = g.vertices.size();
+
+        // Renumber vertices in address order
+        std::vector<node_id_t> order(nv);
+        for (node_id_t v = 0; v < nv; ++v)
+            order[v] = v;
+        std::sort(order.begin(), order.end(), [this](node_id_t a, node_id_t b) { return g.vertices[a] < g.vertices[b]; });
+        std::vector<node_id_t> remap(nv);
+        std::vector<ea_t> vertices(nv);
+        std::vector<uint8_t> vflags(nv);
+        for (node_id_t n = 0; n < nv; ++n)
+        {
+            remap[order[n]] = n;
+            vertices[n] = g.vertices[order[n]];
+            vflags[n] = g.vertex_flags[order[n]];
+        }
+        g.vertices.swap(vertices);
+        g.vertex_flags.swap(vflags);
+
+        // Counting sort of the edges by caller, stable within each caller
+        size_t ne = edge_from.size();
+        g.row_start.assign(nv + 1, 0);
+        for (auto& from : edge_from)
+        {
+            from = remap[from];
+            ++g.row_start[from + 1];
+        }
+        for (size_t v = 1; v <= nv; ++v)
+            g.row_start[v] += g.row_start[v - 1];
+
+        std::vector<uint32_t> pos(ne);
+        std::vector<uint32_t> fill(g.row_start.begin(), g.row_start.end() - 1);
+        for (size_t e = 0; e < ne; ++e)
+            pos[e] = fill[edge_from[e]]++;
+
+        auto permute = [&pos, ne](auto& column)
+        {
+            std::remove_reference_t<decltype(column)> out(ne);
+            for (size_t e = 0; e < ne; ++e)
+                out[pos[e]] = column[e];
+            column.swap(out);
+        };
+        for (auto& to : g.edge_to)
+            if (to != BAD_NODE_ID)
+                to = remap[to];
+        permute(g.edge_to);
+        permute(g.edge_ea);
+        permute(g.edge_node);
+        permute(g.edge_nargs);
+        permute(g.edge_kind);
+
+        edge_from.clear();
+        edge_from.shrink_to_fit();
+        vertex_ids.clear();
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Extract the call graph of the functions selected by a batch query.
+ *
+ * Cached snapshots are used as-is; other functions are decompiled through the
+ * query's bounded cfunc cache and their transient snapshots dropped after
+ * extraction (unless the query has BQF_SNAPSHOTS).
+ *
+ * @example
+ * @code
+ * batch_query_t q(&cache);
+ * call_graph_t g;
+ * extract_call_graph(q, g);
+ * node_id_t v = g.find_vertex(get_screen_ea());
+ * for (auto e = g.edges_begin(v); e < g.edges_end(v); ++e)
+ *     msg("%a -> %a (%u args)\n", g.edge_ea[e], g.vertices[g.edge_to[e]], g.edge_nargs[e]);
+ * @endcode
+ *
+ * @param q Batch query (order, function list, flags and cache)
+ * @param g Output graph
+ * @param flags CGF_* flags
+ * @return Run statistics
+ */
+inline batch_stats_t extract_call_graph(batch_query_t& q, call_graph_t& g, uint32_t flags = CGF_NONE)
+{
+    call_graph_builder_t builder(g, flags);
+    // Functions without calls still become (leaf) vertices, so nothing is pruned
+    ctype_set_t saved_ops = q.ops;
+    q.ops.reset();
+    auto st = q.for_each_snapshot([&](const ctree_snapshot_t& snap, batch_stats_t&)
+    {
+        builder.add(snap);
+        return true;
+    });
+    q.ops = saved_ops;
+    builder.finish();
+    return st;
+}
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,700 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Statement-level CFG and bit-vector dataflow
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Statement-level control-flow graph of a ctree.
+ *
+ * The function body is lowered into a flat list of elements in program
+ * order: simple statements (cit_expr, cit_return, cit_goto, cit_break,
+ * cit_continue, cit_asm) and the condition expressions of if, loops and
+ * switch. Each element is a snapshot node, so its subtree [node, end[node])
+ * holds everything it evaluates.
+ *
+ * Basic blocks are contiguous ranges of that list, and successor and
+ * predecessor edges are stored in CSR form. Block `entry` starts the
+ * function; every return (and the fall-through end of the body) reaches the
+ * empty block `exit`. Join blocks may be empty.
+ *
+ * Gotos are resolved through statement labels, which are only known when
+ * live items are available (build(cfunc) or a non-detached snapshot); on a
+ * detached snapshot they conservatively lead to `exit` and are counted in
+ * `unresolved_gotos`. Switches always get an edge to their exit, since the
+ * snapshot does not record whether a default case exists.
+ *
+ * @example
+ * @code
+ * ctree_snapshot_t snap;
+ * snap.build(cfunc);
+ * stmt_cfg_t cfg;
+ * cfg.build(snap);
+ * for (uint32_t b = 0; b < cfg.block_count(); ++b)
+ *     for (uint32_t s : cfg.successors(b))
+ *         msg("%u -> %u\n", b, s);
+ * @endcode
+ */
+class stmt_cfg_t
+{
+public:
+    std::vector<node_id_t> elems;         ///< Element nodes, in program order
+    std::vector<uint32_t> elem_block;     ///< Block of each element
+    std::vector<uint32_t> block_first;    ///< First element of each block
+    std::vector<uint32_t> block_last;     ///< One past the last element of each block
+    std::vector<uint32_t> succ_start;     ///< Successor offsets (size = block_count() + 1)
+    std::vector<uint32_t> succ;           ///< Successor blocks
+    std::vector<uint32_t> pred_start;     ///< Predecessor offsets (size = block_count() + 1)
+    std::vector<uint32_t> pred;           ///< Predecessor blocks
+    uint32_t entry = 0;                   ///< Entry block
+    uint32_t exit = 0;                    ///< Exit block
+    size_t unresolved_gotos = 0;          ///< Gotos whose label could not be resolved
+
+private:
+    static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+
+    // Builder state
+    const ctree_snapshot_t* snap = nullptr;
+    uint32_t cur = NO_BLOCK;
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    std::vector<std::pair<uint32_t, uint32_t>> targets;   ///< (break, continue) per enclosing construct
+    std::unordered_map<int, uint32_t> labels;
+    std::vector<bool> placed;
+
+    uint32_t new_block()
+    {
+        block_first.push_back(0);
+        block_last.push_back(0);
+        placed.push_back(false);
+        return uint32_t(block_first.size() - 1);
+    }
+
+    /// Make b the block being filled; it starts at the next element
+    void place(uint32_t b)
+    {
+        block_first[b] = block_last[b] = uint32_t(elems.size());
+        placed[b] = true;
+        cur = b;
+    }
+
+    void edge(uint32_t from, uint32_t to)
+    {
+        edges.emplace_back(from, to);
+    }
+
+    void append(node_id_t n)
+    {
+        elems.push_back(n);
+        block_last[cur] = uint32_t(elems.size());
+    }
+
+    /// Continue in a fresh block with no fall-through into it
+    void detach_flow()
+    {
+        place(new_block());
+    }
+
+    uint32_t label_block(int num)
+    {
+        auto [p, inserted] = labels.try_emplace(num, NO_BLOCK);
+        if (inserted)
+            p->second = new_block();
+        return p->second;
+    }
+
+    int label_of(node_id_t s) const
+    {
+        if (!snap->has_items())
+            return -1;
+        return ((const cinsn_t*)snap->items[s])->label_num;
+    }
+
+    void lower(node_id_t s)
+    {
+        auto op = snap->op_of(s);
+        if (op < cit_empty)
+        {
+            if (op != cot_empty)
+                append(s);
+            return;
+        }
+
+        // A labeled statement starts a block that gotos can reach
+        int label = label_of(s);
+        if (label >= 0)
+        {
+            uint32_t b = label_block(label);
+            edge(cur, b);
+            place(b);
+        }
+
+        node_id_t c0 = snap->first_child(s);
+        node_id_t c1 = c0 == BAD_NODE_ID ? BAD_NODE_ID : snap->next_sibling(c0);
+        node_id_t c2 = c1 == BAD_NODE_ID ? BAD_NODE_ID : snap->next_sibling(c1);
+
+        switch (op)
+        {
+            case cit_empty:
+                break;
+
+            case cit_block:
+                for (node_id_t c = c0; c != BAD_NODE_ID; c = snap->next_sibling(c))
+                    lower(c);
+                break;
+
+            case cit_return:
+                append(s);
+                edge(cur, exit);
+                detach_flow();
+                break;
+
+            case cit_goto:
+            {
+                append(s);
+                if (snap->has_items())
+                {
+                    edge(cur, label_block(int(snap->aux[s])));
+                }
+                else
+                {
+                    edge(cur, exit);
+                    ++unresolved_gotos;
+                }
+                detach_flow();
+                break;
+            }
+
+            case cit_break:
+            case cit_continue:
+            {
+                append(s);
+                uint32_t t = targets.empty() ? NO_BLOCK
+                           : (op == cit_break ? targets.back().first : targets.back().second);
+                edge(cur, t == NO_BLOCK ? exit : t);
+                detach_flow();
+                break;
+            }
+
+            case cit_if:
+            {
+                append(c0);
+                uint32_t head = cur;
+                uint32_t join = new_block();
+                uint32_t then_b = new_block();
+                edge(head, then_b);
+                place(then_b);
+                lower(c1);
+                edge(cur, join);
+                if (c2 != BAD_NODE_ID)
+                {
+                    uint32_t else_b = new_block();
+                    edge(head, else_b);
+                    place(else_b);
+                    lower(c2);
+                    edge(cur, join);
+                }
+                else
+                {
+                    edge(head, join);
+                }
+                place(join);
+                break;
+            }
+
+            case cit_while:
+            {
+                uint32_t head = new_block();
+                uint32_t body = new_block();
+                uint32_t done = new_block();
+                edge(cur, head);
+                place(head);
+                append(c0);
+                edge(head, body);
+                edge(head, done);
+                targets.emplace_back(done, head);
+                place(body);
+                lower(c1);
+                edge(cur, head);
+                targets.pop_back();
+                place(done);
+                break;
+            }
+
+            case cit_do:
+            {
+                uint32_t body = new_block();
+                uint32_t cond = new_block();
+                uint32_t done = new_block();
+                edge(cur, body);
+                place(body);
+                targets.emplace_back(done, cond);
+                lower(c0);
+                targets.pop_back();
+                edge(cur, cond);
+                place(cond);
+                append(c1);
+                edge(cond, body);
+                edge(cond, done);
+                place(done);
+                break;
+            }
+
+            case cit_for:
+            {
+                // Children: init, condition, step, body
+                node_id_t body_n = c2 == BAD_NODE_ID ? BAD_NODE_ID : snap->next_sibling(c2);
+                lower(c0);
+                uint32_t head = new_block();
+                uint32_t body = new_block();
+                uint32_t step = new_block();
+                uint32_t done = new_block();
+                edge(cur, head);
+                place(head);
+                bool infinite = snap->op_of(c1) == cot_empty;
+                lower(c1);
+                edge(head, body);
+                if (!infinite)
+                    edge(head, done);
+                targets.emplace_back(done, step);
+                place(body);
+                if (body_n != BAD_NODE_ID)
+                    lower(body_n);
+                edge(cur, step);
+                targets.pop_back();
+                place(step);
+                lower(c2);
+                edge(cur, head);
+                place(done);
+                break;
+            }
+
+            case cit_switch:
+            {
+                append(c0);
+                uint32_t head = cur;
+                uint32_t done = new_block();
+                uint32_t cont = targets.empty() ? NO_BLOCK : targets.back().second;
+                targets.emplace_back(done, cont);
+                uint32_t prev = NO_BLOCK;
+                for (node_id_t c = c1; c != BAD_NODE_ID; c = snap->next_sibling(c))
+                {
+                    uint32_t case_b = new_block();
+                    edge(head, case_b);
+                    if (prev != NO_BLOCK)
+                        edge(prev, case_b);   // fall-through from the previous case
+                    place(case_b);
+                    lower(c);
+                    prev = cur;
+                }
+                targets.pop_back();
+                edge(prev == NO_BLOCK ? head : prev, done);
+                edge(head, done);
+                place(done);
+                break;
+            }
+
+            default:
+                // cit_expr, cit_asm and anything else evaluated as one unit
+                append(s);
+                break;
+        }
+    }
+
+    static void make_csr(
+        uint32_t nblocks,
+        const std::vector<std::pair<uint32_t, uint32_t>>& e,
+        bool reverse,
+        std::vector<uint32_t>& start,
+        std::vector<uint32_t>& out)
+    {
+        start.assign(nblocks + 1, 0);
+        for (auto& [f, t] : e)
+            ++start[(reverse ? t : f) + 1];
+        for (uint32_t i = 1; i <= nblocks; ++i)
+            start[i] += start[i - 1];
+        out.resize(e.size());
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (auto& [f, t] : e)
+            out[fill[reverse ? t : f]++] = reverse ? f : t;
+    }
+
+    /// Drop the empty placeholder blocks nothing jumps to, then build the CSR arrays
+    void finish()
+    {
+        uint32_t n = uint32_t(block_first.size());
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::vector<uint32_t> npred(n, 0);
+        for (auto& [f, t] : edges)
+            ++npred[t];
+        std::vector<uint32_t> remap(n, NO_BLOCK);
+        uint32_t kept = 0;
+        for (uint32_t b = 0; b < n; ++b)
+        {
+            bool removable = b != entry && b != exit && npred[b] == 0 && block_first[b] == block_last[b];
+            if (!removable)
+            {
+                block_first[kept] = block_first[b];
+                block_last[kept] = block_last[b];
+                remap[b] = kept++;
+            }
+        }
+        block_first.resize(kept);
+        block_last.resize(kept);
+        entry = remap[entry];
+        exit = remap[exit];
+
+        size_t w = 0;
+        for (auto& [f, t] : edges)
+            if (remap[f] != NO_BLOCK)
+                edges[w++] = {remap[f], remap[t]};
+        edges.resize(w);
+
+        make_csr(kept, edges, false, succ_start, succ);
+        make_csr(kept, edges, true, pred_start, pred);
+
+        elem_block.assign(elems.size(), NO_BLOCK);
+        for (uint32_t b = 0; b < kept; ++b)
+            for (uint32_t i = block_first[b]; i < block_last[b]; ++i)
+                elem_block[i] = b;
+
+        edges.clear();
+        edges.shrink_to_fit();
+        targets.clear();
+        labels.clear();
+        placed.clear();
+    }
+
+public:
+    /**
+     * @brief Build the CFG of a snapshot.
+     *
+     * @param s Snapshot rooted at a function body (kept only during the call)
+     */
+    void build(const ctree_snapshot_t& s)
+    {
+        clear();
+        if (s.empty())
+            return;
+        snap = &s;
+        entry = new_block();
+        exit = new_block();
+        place(entry);
+        lower(0);
+        edge(cur, exit);
+        for (auto& [num, b] : labels)
+        {
+            // Label outside the tree: treat the goto as leaving the function
+            if (!placed[b])
+            {
+                edge(b, exit);
+                ++unresolved_gotos;
+            }
+        }
+        place(exit);
+        finish();
+        snap = nullptr;
+    }
+
+    /**
+     * @brief Build the CFG of a decompiled function (gotos are resolved).
+     */
+    void build(cfunc_t* cfunc)
+    {
+        ctree_snapshot_t s;
+        s.build(cfunc);
+        build(s);
+    }
+
+    /**
+     * @brief Remove all blocks and elements.
+     */
+    void clear()
+    {
+        elems.clear();
+        elem_block.clear();
+        block_first.clear();
+        block_last.clear();
+        succ_start.clear();
+        succ.clear();
+        pred_start.clear();
+        pred.clear();
+        entry = exit = 0;
+        unresolved_gotos = 0;
+        cur = NO_BLOCK;
+    }
+
+    /// Number of basic blocks
+    uint32_t block_count() const { return uint32_t(block_first.size()); }
+
+    /// Element nodes of a block, in order
+    std::span<const node_id_t> elems_of(uint32_t b) const
+    {
+        return std::span<const node_id_t>(elems.data() + block_first[b], block_last[b] - block_first[b]);
+    }
+
+    /// Successor blocks of a block
+    std::span<const uint32_t> successors(uint32_t b) const
+    {
+        return std::span<const uint32_t>(succ.data() + succ_start[b], succ_start[b + 1] - succ_start[b]);
+    }
+
+    /// Predecessor blocks of a block
+    std::span<const uint32_t> predecessors(uint32_t b) const
+    {
+        return std::span<const uint32_t>(pred.data() + pred_start[b], pred_start[b + 1] - pred_start[b]);
+    }
+
+    /**
+     * @brief Get the blocks in reverse post-order from the entry (or from
+     *        the exit over predecessor edges when `backward` is set).
+     *
+     * Unreachable blocks are appended at the end.
+     */
+    void reverse_postorder(std::vector<uint32_t>& out, bool backward = false) const
+    {
+        uint32_t n = block_count();
+        out.clear();
+        if (n == 0)
+            return;
+        std::vector<uint8_t> seen(n, 0);
+        std::vector<std::pair<uint32_t, uint32_t>> stack;   // (block, next edge)
+        auto walk = [&](uint32_t root)
+        {
+            if (seen[root] != 0)
+                return;
+            seen[root] = 1;
+            stack.emplace_back(root, 0);
+            while (!stack.empty())
+            {
+                auto& [b, k] = stack.back();
+                auto next = backward ? predecessors(b) : successors(b);
+                if (k < next.size())
+                {
+                    uint32_t t = next[k++];
+                    if (seen[t] == 0)
+                    {
+                        seen[t] = 1;
+                        stack.emplace_back(t, 0);
+                    }
+                }
+                else
+                {
+                    out.push_back(b);
+                    stack.pop_back();
+                }
+            }
+        };
+        walk(backward ? exit : entry);
+        std::reverse(out.begin(), out.end());
+        for (uint32_t b = 0; b < n; ++b)
+            if (seen[b] == 0)
+                out.push_back(b);
+    }
+
+    /**
+     * @brief Approximate heap memory used by the graph, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return (elems.capacity() + elem_block.capacity() + block_first.capacity() + block_last.capacity()
+              + succ_start.capacity() + succ.capacity() + pred_start.capacity() + pred.capacity()) * sizeof(uint32_t);
+    }
+};
+
+//----------------------------------------------------------------------------------
+/// Dataflow direction
+enum dataflow_dir_t
+{
+    DF_FORWARD,     ///< Facts flow from predecessors (e.g. reaching definitions)
+    DF_BACKWARD,    ///< Facts flow from successors (e.g. liveness)
+};
+
+/// Dataflow meet operator
+enum dataflow_meet_t
+{
+    DF_UNION,       ///< May analysis
+    DF_INTERSECT,   ///< Must analysis
+};
+
+/**
+ * @brief Generic gen/kill bit-vector dataflow solver over a stmt_cfg_t.
+ *
+ * Per block, out = gen | (in & ~kill) in the analysis direction. Sets are
+ * flat arrays of 64-bit words, block-major, so the whole problem lives in
+ * four allocations. The worklist is seeded in reverse post-order, which
+ * usually converges in two or three sweeps.
+ *
+ * @example
+ * @code
+ * // Liveness of local variables: a use generates, a definition kills
+ * bitvec_dataflow_t df;
+ * df.init(cfg, nvars, DF_BACKWARD, DF_UNION);
+ * for (uint32_t b = 0; b < cfg.block_count(); ++b)
+ *     for (auto it = cfg.elems_of(b).rbegin(); it != cfg.elems_of(b).rend(); ++it)
+ *         apply_stmt(snap, *it, df.gen_of(b), df.kill_of(b));   // kill defs, gen uses
+ * df.solve(cfg);
+ * bool live = bitvec_dataflow_t::test(df.in_of(b), var_idx);
+ * @endcode
+ */
+class bitvec_dataflow_t
+{
+public:
+    dataflow_dir_t dir = DF_FORWARD;
+    dataflow_meet_t meet = DF_UNION;
+    uint32_t nbits = 0;                  ///< Facts per set
+    uint32_t words = 0;                  ///< 64-bit words per set
+    std::vector<uint64_t> gen;           ///< Generated facts per block
+    std::vector<uint64_t> kill;          ///< Killed facts per block
+    std::vector<uint64_t> in;            ///< Facts at block start (program order)
+    std::vector<uint64_t> out;           ///< Facts at block end (program order)
+    std::vector<uint64_t> boundary;      ///< Facts entering at the entry (forward) or exit (backward)
+
+    /**
+     * @brief Allocate the sets for a CFG.
+     *
+     * @param cfg Control-flow graph
+     * @param facts Number of facts (bits per set)
+     * @param d Direction
+     * @param m Meet operator
+     */
+    void init(const stmt_cfg_t& cfg, uint32_t facts, dataflow_dir_t d, dataflow_meet_t m)
+    {
+        dir = d;
+        meet = m;
+        nbits = facts;
+        words = (facts + 63) / 64;
+        size_t total = size_t(cfg.block_count()) * words;
+        gen.assign(total, 0);
+        kill.assign(total, 0);
+        in.assign(total, 0);
+        out.assign(total, 0);
+        boundary.assign(words, 0);
+    }
+
+    uint64_t* gen_of(uint32_t b) { return gen.data() + size_t(b) * words; }
+    uint64_t* kill_of(uint32_t b) { return kill.data() + size_t(b) * words; }
+    const uint64_t* in_of(uint32_t b) const { return in.data() + size_t(b) * words; }
+    const uint64_t* out_of(uint32_t b) const { return out.data() + size_t(b) * words; }
+
+    /// Set one bit of a set
+    static void set(uint64_t* v, uint32_t bit) { v[bit / 64] |= uint64_t(1) << (bit % 64); }
+
+    /// Clear one bit of a set
+    static void reset(uint64_t* v, uint32_t bit) { v[bit / 64] &= ~(uint64_t(1) << (bit % 64)); }
+
+    /// Test one bit of a set
+    static bool test(const uint64_t* v, uint32_t bit) { return (v[bit / 64] >> (bit % 64) & 1) != 0; }
+
+    /**
+     * @brief Solve to a fixed point.
+     *
+     * @param cfg The CFG passed to init()
+     * @return Number of block evaluations
+     */
+    size_t solve(const stmt_cfg_t& cfg)
+    {
+        uint32_t n = cfg.block_count();
+        if (n == 0)
+            return 0;
+
+        bool fwd = dir == DF_FORWARD;
+        uint32_t start = fwd ? cfg.entry : cfg.exit;
+        // "before" is the side facts enter a block from, "after" the side they leave
+        std::vector<uint64_t>& before = fwd ? in : out;
+        std::vector<uint64_t>& after = fwd ? out : in;
+
+        uint64_t top = meet == DF_INTERSECT ? ~uint64_t(0) : 0;
+        std::fill(after.begin(), after.end(), top);
+        std::fill(before.begin(), before.end(), top);
+
+        std::vector<uint32_t> order;
+        cfg.reverse_postorder(order, !fwd);
+        std::vector<uint32_t> queue(order.begin(), order.end());
+        std::vector<uint8_t> queued(n, 1);
+
+        size_t evals = 0;
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            uint32_t b = queue[head];
+            queued[b] = 0;
+            ++evals;
+
+            // Meet over the incoming side
+            auto from = fwd ? cfg.predecessors(b) : cfg.successors(b);
+            uint64_t* bin = before.data() + size_t(b) * words;
+            if (b == start)
+            {
+                std::copy(boundary.begin(), boundary.end(), bin);
+            }
+            else if (from.empty())
+            {
+                std::fill(bin, bin + words, 0);
+            }
+            else
+            {
+                std::fill(bin, bin + words, top);
+                for (uint32_t p : from)
+                {
+                    const uint64_t* pa = after.data() + size_t(p) * words;
+                    for (uint32_t w = 0; w < words; ++w)
+                        bin[w] = meet == DF_UNION ? (bin[w] | pa[w]) : (bin[w] & pa[w]);
+                }
+            }
+
+            // Transfer
+            const uint64_t* g = gen.data() + size_t(b) * words;
+            const uint64_t* k = kill.data() + size_t(b) * words;
+            uint64_t* bout = after.data() + size_t(b) * words;
+            bool changed = false;
+            for (uint32_t w = 0; w < words; ++w)
+            {
+                uint64_t v = g[w] | (bin[w] & ~k[w]);
+                changed |= v != bout[w];
+                bout[w] = v;
+            }
+
+            if (changed)
+            {
+                for (uint32_t s : (fwd ? cfg.successors(b) : cfg.predecessors(b)))
+                {
+                    if (queued[s] == 0)
+                    {
+                        queued[s] = 1;
+                        queue.push_back(s);
+                    }
+                }
+            }
+        }
+        return evals;
+    }
+
+    /**
+     * @brief Approximate heap memory used by the sets, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return (gen.capacity() + kill.capacity() + in.capacity() + out.capacity() + boundary.capacity()) * sizeof(uint64_t);
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,462 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Structural diff between two ctree snapshots
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/hash.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Kind of a ctree edit
+enum diff_kind_t : uint8_t
+{
+    CTD_INSERTED,   ///< Subtree root only present in the new tree
+    CTD_REMOVED,    ///< Subtree root only present in the old tree
+    CTD_UPDATED,    ///< Matched node whose payload changed (number, variable, object...)
+    CTD_MOVED,      ///< Matched node that now has a different parent
+};
+
+/// One edit between two snapshots
+struct diff_edit_t
+{
+    diff_kind_t kind;
+    node_id_t old_node;    ///< Node in the old snapshot, or BAD_NODE_ID for CTD_INSERTED
+    node_id_t new_node;    ///< Node in the new snapshot, or BAD_NODE_ID for CTD_REMOVED
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Structural diff between two snapshots of the same function.
+ *
+ * Aligns the nodes of an old and a new snapshot (typically taken before and
+ * after a type change or rename forced a re-decompilation) in three passes:
+ *
+ * 1. Anchors: identical subtrees (equal structural hash, ordered) are matched
+ *    whole, largest first, preferring candidates at the same EA or under an
+ *    already matched parent.
+ * 2. Bottom-up: an unmatched node is matched to the parent most of its matched
+ *    children moved to, if the item type agrees.
+ * 3. Top-down: the remaining children of matched nodes are paired by item type
+ *    and EA, in order; identical subtrees that gained or lost a wrapper (such
+ *    as a cast) are matched across that one level.
+ *
+ * The result is a node mapping in both directions plus an edit list. Nodes
+ * whose whole subtree is unchanged are flagged, so analysis results keyed by
+ * node can be carried over and only the changed regions recomputed.
+ *
+ * @example
+ * @code
+ * auto before = make_snapshot(cfunc);
+ * // ... set a type, re-decompile ...
+ * ctree_snapshot_t after;
+ * after.build(new_cfunc, false);
+ *
+ * ctree_diff_t d;
+ * d.compute(*before, after);
+ * d.for_each_unchanged([&](node_id_t o, node_id_t n) { reuse(o, n); });
+ * for (auto& e : d.edits)
+ *     if (e.kind == CTD_INSERTED)
+ *         recompute(e.new_node);
+ * @endcode
+ */
+class ctree_diff_t
+{
+public:
+    std::vector<node_id_t> old_to_new;   ///< Old node -> matched new node, or BAD_NODE_ID
+    std::vector<node_id_t> new_to_old;   ///< New node -> matched old node, or BAD_NODE_ID
+    std::vector<diff_edit_t> edits;      ///< Edits, removals first, then in new pre-order
+
+private:
+    const ctree_snapshot_t* a = nullptr;
+    const ctree_snapshot_t* b = nullptr;
+    std::vector<hash128_t> ha;
+    std::vector<hash128_t> hb;
+    std::vector<uint8_t> same_old;       ///< 1 if the old subtree maps unchanged
+    std::vector<uint8_t> used_old;       ///< 1 if the old subtree contains a matched node
+    std::vector<uint8_t> used_new;       ///< 1 if the new subtree contains a matched node
+
+    // Scratch
+    std::vector<std::pair<hash128_t, node_id_t>> by_hash;
+    std::vector<node_id_t> votes;
+    std::vector<node_id_t> free_new;
+
+    /// Flag a node and its ancestors; stops at the first flagged one, whose ancestors are flagged already
+    static void mark_used(const ctree_snapshot_t* s, std::vector<uint8_t>& used, node_id_t x)
+    {
+        for (; x != BAD_NODE_ID && used[x] == 0; x = s->parent[x])
+            used[x] = 1;
+    }
+
+    void match(node_id_t o, node_id_t n)
+    {
+        old_to_new[o] = n;
+        new_to_old[n] = o;
+        mark_used(a, used_old, o);
+        mark_used(b, used_new, n);
+    }
+
+    /// true if no node of either subtree is matched yet (O(1))
+    bool subtrees_free(node_id_t o, node_id_t n) const
+    {
+        return used_old[o] == 0 && used_new[n] == 0;
+    }
+
+    /// Match two identical subtrees node by node (same shape, same pre-order)
+    void match_subtree(node_id_t o, node_id_t n)
+    {
+        for (node_id_t k = 0; o + k < a->end[o]; ++k)
+            match(o + k, n + k);
+    }
+
+    void match_anchors(uint32_t min_nodes)
+    {
+        by_hash.clear();
+        for (node_id_t j = 0; j < b->size(); ++j)
+            if (b->end[j] - j >= min_nodes)
+                by_hash.emplace_back(hb[j], j);
+        std::sort(by_hash.begin(), by_hash.end(), [](const auto& x, const auto& y)
+        {
+            return x.first < y.first || (x.first == y.first && x.second < y.second);
+        });
+
+        // Pre-order visits larger subtrees before the subtrees they contain
+        for (node_id_t i = 0; i < a->size();)
+        {
+            if (a->end[i] - i < min_nodes)
+            {
+                ++i;
+                continue;
+            }
+
+            auto lo = std::lower_bound(by_hash.begin(), by_hash.end(), std::make_pair(ha[i], node_id_t(0)));
+            node_id_t best = BAD_NODE_ID;
+            int best_score = -1;
+            node_id_t want_parent = a->parent[i] == BAD_NODE_ID ? BAD_NODE_ID : old_to_new[a->parent[i]];
+            for (auto p = lo; p != by_hash.end() && p->first == ha[i]; ++p)
+            {
+                node_id_t j = p->second;
+                if (new_to_old[j] != BAD_NODE_ID)
+                    continue;
+                int score = (a->ea[i] == b->ea[j] ? 2 : 0)
+                          + (want_parent != BAD_NODE_ID && b->parent[j] == want_parent ? 1 : 0);
+                if (score > best_score && subtrees_free(i, j))
+                {
+                    best = j;
+                    best_score = score;
+                    if (score == 3)
+                        break;
+                }
+            }
+
+            if (best != BAD_NODE_ID)
+            {
+                match_subtree(i, best);
+                i = a->end[i];
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    void match_parents()
+    {
+        for (size_t i = a->size(); i-- > 0;)
+        {
+            auto o = node_id_t(i);
+            if (old_to_new[o] != BAD_NODE_ID)
+                continue;
+
+            votes.clear();
+            for (node_id_t c = a->first_child(o); c != BAD_NODE_ID; c = a->next_sibling(c))
+                if (old_to_new[c] != BAD_NODE_ID && b->parent[old_to_new[c]] != BAD_NODE_ID)
+                    votes.push_back(b->parent[old_to_new[c]]);
+            if (votes.empty())
+                continue;
+
+            std::sort(votes.begin(), votes.end());
+            node_id_t cand = BAD_NODE_ID;
+            size_t best = 0;
+            for (size_t k = 0; k < votes.size();)
+            {
+                size_t e = k;
+                while (e < votes.size() && votes[e] == votes[k])
+                    ++e;
+                if (e - k > best)
+                {
+                    best = e - k;
+                    cand = votes[k];
+                }
+                k = e;
+            }
+            if (new_to_old[cand] == BAD_NODE_ID && b->op[cand] == a->op[o])
+                match(o, cand);
+        }
+
+        if (!a->empty() && !b->empty()
+         && old_to_new[0] == BAD_NODE_ID && new_to_old[0] == BAD_NODE_ID
+         && a->op[0] == b->op[0])
+        {
+            match(0, 0);
+        }
+    }
+
+    /// Pair one unmatched old child with an unmatched new child
+    void pair_child(node_id_t c, node_id_t n)
+    {
+        if (ha[c] == hb[n] && subtrees_free(c, n))
+            match_subtree(c, n);
+        else
+            match(c, n);
+    }
+
+    void match_children()
+    {
+        for (node_id_t o = 0; o < a->size(); ++o)
+        {
+            node_id_t n = old_to_new[o];
+            if (n == BAD_NODE_ID)
+                continue;
+
+            free_new.clear();
+            for (node_id_t c = b->first_child(n); c != BAD_NODE_ID; c = b->next_sibling(c))
+                if (new_to_old[c] == BAD_NODE_ID)
+                    free_new.push_back(c);
+            if (free_new.empty())
+                continue;
+
+            // Same type at the same address first
+            for (node_id_t c = a->first_child(o); c != BAD_NODE_ID; c = a->next_sibling(c))
+            {
+                if (old_to_new[c] != BAD_NODE_ID || a->ea[c] == BADADDR)
+                    continue;
+                for (auto& f : free_new)
+                {
+                    if (f != BAD_NODE_ID && b->op[f] == a->op[c] && b->ea[f] == a->ea[c])
+                    {
+                        pair_child(c, f);
+                        f = BAD_NODE_ID;
+                        break;
+                    }
+                }
+            }
+
+            // Then same type, keeping the sibling order
+            size_t k = 0;
+            for (node_id_t c = a->first_child(o); c != BAD_NODE_ID; c = a->next_sibling(c))
+            {
+                if (old_to_new[c] != BAD_NODE_ID)
+                    continue;
+                for (size_t s = k; s < free_new.size(); ++s)
+                {
+                    node_id_t f = free_new[s];
+                    if (f != BAD_NODE_ID && b->op[f] == a->op[c])
+                    {
+                        pair_child(c, f);
+                        free_new[s] = BAD_NODE_ID;
+                        k = s + 1;
+                        break;
+                    }
+                }
+            }
+
+            // Wrapped or unwrapped children (e.g. a cast inserted by a type
+            // change): look for the identical subtree one level further down
+            for (node_id_t c = a->first_child(o); c != BAD_NODE_ID; c = a->next_sibling(c))
+            {
+                if (old_to_new[c] != BAD_NODE_ID)
+                    continue;
+                for (node_id_t f = b->first_child(n); f != BAD_NODE_ID && old_to_new[c] == BAD_NODE_ID; f = b->next_sibling(f))
+                {
+                    if (new_to_old[f] != BAD_NODE_ID)
+                        continue;
+                    for (node_id_t g = b->first_child(f); g != BAD_NODE_ID; g = b->next_sibling(g))
+                    {
+                        if (hb[g] == ha[c] && subtrees_free(c, g))
+                        {
+                            match_subtree(c, g);
+                            break;
+                        }
+                    }
+                }
+            }
+            for (node_id_t f = b->first_child(n); f != BAD_NODE_ID; f = b->next_sibling(f))
+            {
+                if (new_to_old[f] != BAD_NODE_ID)
+                    continue;
+                for (node_id_t c = a->first_child(o); c != BAD_NODE_ID && new_to_old[f] == BAD_NODE_ID; c = a->next_sibling(c))
+                {
+                    if (old_to_new[c] != BAD_NODE_ID)
+                        continue;
+                    for (node_id_t g = a->first_child(c); g != BAD_NODE_ID; g = a->next_sibling(g))
+                    {
+                        if (ha[g] == hb[f] && subtrees_free(g, f))
+                        {
+                            match_subtree(g, f);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void classify()
+    {
+        // A subtree is unchanged if it is matched, hashes equal, and every
+        // child maps to the child at the same offset in the new subtree.
+        same_old.assign(a->size(), 0);
+        for (size_t i = a->size(); i-- > 0;)
+        {
+            auto o = node_id_t(i);
+            node_id_t n = old_to_new[o];
+            if (n == BAD_NODE_ID || ha[o] != hb[n] || a->end[o] - o != b->end[n] - n)
+                continue;
+            bool ok = true;
+            for (node_id_t c = a->first_child(o); ok && c != BAD_NODE_ID; c = a->next_sibling(c))
+                ok = same_old[c] != 0 && old_to_new[c] == n + (c - o);
+            same_old[o] = ok ? 1 : 0;
+        }
+
+        edits.clear();
+        for (node_id_t o = 0; o < a->size(); ++o)
+        {
+            node_id_t p = a->parent[o];
+            if (old_to_new[o] == BAD_NODE_ID && (p == BAD_NODE_ID || old_to_new[p] != BAD_NODE_ID))
+                edits.push_back(diff_edit_t{CTD_REMOVED, o, BAD_NODE_ID});
+        }
+        for (node_id_t n = 0; n < b->size(); ++n)
+        {
+            node_id_t o = new_to_old[n];
+            node_id_t p = b->parent[n];
+            if (o == BAD_NODE_ID)
+            {
+                if (p == BAD_NODE_ID || new_to_old[p] != BAD_NODE_ID)
+                    edits.push_back(diff_edit_t{CTD_INSERTED, BAD_NODE_ID, n});
+                continue;
+            }
+            if (a->aux[o] != b->aux[n])
+                edits.push_back(diff_edit_t{CTD_UPDATED, o, n});
+            node_id_t op = a->parent[o];
+            if (op != BAD_NODE_ID && p != BAD_NODE_ID && old_to_new[op] != p)
+                edits.push_back(diff_edit_t{CTD_MOVED, o, n});
+        }
+    }
+
+public:
+    /**
+     * @brief Compute the diff between two snapshots.
+     *
+     * Both snapshots must stay alive while the diff is queried.
+     *
+     * @param old_snap Snapshot before the change
+     * @param new_snap Snapshot after the change
+     * @param hash_flags CTH_* flags deciding which payloads count as changes
+     *        (CTH_ORDERED is always added so matched children line up)
+     * @param min_anchor Smallest subtree (in nodes) matched in the anchor pass;
+     *        smaller ones are only paired under matched parents
+     */
+    void compute(
+        const ctree_snapshot_t& old_snap,
+        const ctree_snapshot_t& new_snap,
+        uint32_t hash_flags = CTH_NONE,
+        uint32_t min_anchor = 2)
+    {
+        a = &old_snap;
+        b = &new_snap;
+        ctree_hasher_t hasher(hash_flags | CTH_ORDERED);
+        hasher.hash(old_snap, ha);
+        hasher.hash(new_snap, hb);
+        old_to_new.assign(old_snap.size(), BAD_NODE_ID);
+        new_to_old.assign(new_snap.size(), BAD_NODE_ID);
+        used_old.assign(old_snap.size(), 0);
+        used_new.assign(new_snap.size(), 0);
+
+        match_anchors(std::max<uint32_t>(min_anchor, 1));
+        match_parents();
+        match_children();
+        classify();
+    }
+
+    /// true if both trees are structurally identical
+    bool identical() const
+    {
+        return !same_old.empty() && same_old[0] != 0 && b->size() == a->size();
+    }
+
+    /// true if the old node's whole subtree maps unchanged onto the new tree
+    bool is_unchanged_old(node_id_t o) const { return same_old[o] != 0; }
+
+    /// true if the new node's whole subtree is unchanged from the old tree
+    bool is_unchanged_new(node_id_t n) const
+    {
+        node_id_t o = new_to_old[n];
+        return o != BAD_NODE_ID && same_old[o] != 0 && old_to_new[o] == n;
+    }
+
+    /**
+     * @brief Enumerate the maximal unchanged subtrees.
+     *
+     * @param cb Callback receiving (old node, new node) for each subtree root
+     */
+    template <typename F>
+    void for_each_unchanged(F cb) const
+    {
+        for (node_id_t o = 0; o < a->size();)
+        {
+            if (same_old[o] != 0)
+            {
+                cb(o, old_to_new[o]);
+                o = a->end[o];
+            }
+            else
+            {
+                ++o;
+            }
+        }
+    }
+
+    /// Number of matched nodes
+    size_t matched() const
+    {
+        return size_t(std::count_if(old_to_new.begin(), old_to_new.end(),
+                                    [](node_id_t n) { return n != BAD_NODE_ID; }));
+    }
+
+    /// Number of old nodes inside unchanged subtrees
+    size_t unchanged_nodes() const
+    {
+        size_t total = 0;
+        for_each_unchanged([&](node_id_t o, node_id_t) { total += a->end[o] - o; });
+        return total;
+    }
+
+    /**
+     * @brief Approximate heap memory used by the diff, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return (old_to_new.capacity() + new_to_old.capacity() + votes.capacity() + free_new.capacity()) * sizeof(node_id_t)
+             + edits.capacity() * sizeof(diff_edit_t)
+             + (ha.capacity() + hb.capacity()) * sizeof(hash128_t)
+             + same_old.capacity() + used_old.capacity() + used_new.capacity()
+             + by_hash.capacity() * sizeof(by_hash[0]);
+    }
+};
+
+}  // namespace idacpp::hexrays
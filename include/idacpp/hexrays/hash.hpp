@@ -0,0 +1,365 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Structural ctree hashing and subtree dedup
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief 128-bit structural hash. Use `lo` alone when 64 bits are enough.
+ */
+struct hash128_t
+{
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const hash128_t& r) const { return lo == r.lo && hi == r.hi; }
+    bool operator!=(const hash128_t& r) const { return !(*this == r); }
+    bool operator<(const hash128_t& r) const { return hi < r.hi || (hi == r.hi && lo < r.lo); }
+};
+
+/// Hasher for unordered containers keyed by hash128_t
+struct hash128_hasher_t
+{
+    size_t operator()(const hash128_t& h) const { return size_t(h.lo ^ (h.hi * 0x9E3779B97F4A7C15ULL)); }
+};
+
+// Structural hash flags:
+#define CTH_NONE           0x00  ///< Hash every payload (variables, objects, numbers)
+#define CTH_IGNORE_VARS    0x01  ///< Treat all local variables as the same variable
+#define CTH_IGNORE_OBJS    0x02  ///< Treat all global objects (and direct callees) alike
+#define CTH_IGNORE_NUMS    0x04  ///< Treat all numeric constants alike
+#define CTH_ORDERED        0x08  ///< Do not canonicalize operands of commutative operators
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Bottom-up structural hasher over a ctree snapshot.
+ *
+ * Produces one hash per node, covering the node's type, its payload (see
+ * snapshot_aux) and the hashes of its children in order. Addresses are never
+ * hashed, so identical code at different EAs or in different functions hashes
+ * the same. Operands of commutative operators are canonicalized unless
+ * CTH_ORDERED is given, so `a + b` and `b + a` collide on purpose.
+ *
+ * Runs in a single reverse pre-order sweep: every child is hashed before its
+ * parent without recursion or extra allocation.
+ *
+ * @example
+ * @code
+ * ctree_snapshot_t snap;
+ * snap.build(cfunc, false);
+ * auto hashes = ctree_hasher_t(CTH_IGNORE_VARS).hash(snap);
+ * msg("function shape: %016llx\n", hashes[0].lo);
+ * @endcode
+ */
+class ctree_hasher_t
+{
+private:
+    uint32_t flags;
+
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static void combine(hash128_t& h, const hash128_t& v)
+    {
+        h.lo = mix(h.lo ^ (v.lo + 0x9E3779B97F4A7C15ULL + (h.lo << 6) + (h.lo >> 2)));
+        h.hi = mix(h.hi ^ (v.hi + 0xC2B2AE3D27D4EB4FULL + (h.hi << 7) + (h.hi >> 3)));
+    }
+
+    uint64_t payload(ctype_t op, uint64_t aux) const
+    {
+        switch (op)
+        {
+            case cot_var: return (flags & CTH_IGNORE_VARS) != 0 ? 0 : aux;
+            case cot_obj: return (flags & CTH_IGNORE_OBJS) != 0 ? 0 : aux;
+            case cot_num: return (flags & CTH_IGNORE_NUMS) != 0 ? 0 : aux;
+            default:      return aux;
+        }
+    }
+
+public:
+    /**
+     * @param flags CTH_* flags
+     */
+    explicit ctree_hasher_t(uint32_t flags = CTH_NONE) : flags(flags) {}
+
+    /**
+     * @brief Hash every subtree of a snapshot.
+     *
+     * @param snap Snapshot (live item pointers are not needed)
+     * @param out Output hashes, indexed by node_id_t
+     */
+    void hash(const ctree_snapshot_t& snap, std::vector<hash128_t>& out) const
+    {
+        size_t n = snap.size();
+        out.resize(n);
+        for (size_t i = n; i-- > 0;)
+        {
+            auto op = snap.op_of(node_id_t(i));
+            uint64_t p = payload(op, snap.aux[i]);
+            hash128_t h{ mix(0x51ED270B27A2F1F1ULL ^ (uint64_t(op) << 56) ^ p),
+                         mix(0x2545F4914F6CDD1DULL ^ uint64_t(op) ^ (p << 8) ^ (p >> 56)) };
+
+            node_id_t c = snap.first_child(node_id_t(i));
+            if ((flags & CTH_ORDERED) == 0 && is_commutative(op) && c != BAD_NODE_ID)
+            {
+                node_id_t c2 = snap.next_sibling(c);
+                if (c2 != BAD_NODE_ID && out[c2] < out[c])
+                    std::swap(c, c2);
+                combine(h, out[c]);
+                if (c2 != BAD_NODE_ID)
+                    combine(h, out[c2]);
+            }
+            else
+            {
+                for (; c != BAD_NODE_ID; c = snap.next_sibling(c))
+                    combine(h, out[c]);
+            }
+            out[i] = h;
+        }
+    }
+
+    /**
+     * @brief Hash every subtree of a snapshot.
+     */
+    std::vector<hash128_t> hash(const ctree_snapshot_t& snap) const
+    {
+        std::vector<hash128_t> out;
+        hash(snap, out);
+        return out;
+    }
+
+    /**
+     * @brief Hash a whole decompiled function.
+     *
+     * @return Hash of the function body
+     */
+    hash128_t hash(cfunc_t* cfunc) const
+    {
+        ctree_snapshot_t snap;
+        snap.build(cfunc, false);
+        std::vector<hash128_t> out;
+        hash(snap, out);
+        return out.empty() ? hash128_t{} : out[0];
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Hash-consed index of subtree shapes across functions.
+ *
+ * Every distinct hash is interned once as a shape; occurrences are kept in a
+ * flat array chained per shape, so answering "all subtrees with this shape"
+ * costs one hash lookup plus the number of occurrences. Small subtrees can be
+ * excluded with `min_nodes` to keep the index compact on large databases.
+ *
+ * @example
+ * @code
+ * subtree_index_t index(CTH_IGNORE_VARS, 8);
+ * batch_query_t q;
+ * q.for_each_cfunc([&](const cfuncptr_t& cf, batch_stats_t&) { index.add(cf); return true; });
+ * index.for_each_clone(2, [](const subtree_index_t::shape_t& s, auto& occs) {
+ *     msg("%u nodes, %zu copies\n", s.nodes, occs.size());
+ *     return true;
+ * });
+ * @endcode
+ */
+class subtree_index_t
+{
+public:
+    /// Interned subtree shape
+    struct shape_t
+    {
+        hash128_t hash;            ///< Structural hash
+        uint32_t nodes = 0;        ///< Subtree size in nodes
+        uint8_t op = 0;            ///< Root item type (ctype_t)
+        uint32_t count = 0;        ///< Number of occurrences
+        uint32_t first = UINT32_MAX;  ///< First occurrence (index into occurrences)
+        uint32_t last = UINT32_MAX;   ///< Last occurrence
+    };
+
+    /// One subtree occurrence
+    struct occurrence_t
+    {
+        ea_t func_ea;              ///< Function containing the subtree
+        ea_t ea;                   ///< Address of the subtree root
+        node_id_t node;            ///< Root node in the function snapshot
+        uint32_t parent_shape;     ///< Shape of the parent subtree, or UINT32_MAX if not indexed
+        uint32_t next;             ///< Next occurrence of the same shape, or UINT32_MAX
+    };
+
+    using occurrences_t = std::vector<const occurrence_t*>;
+
+private:
+    ctree_hasher_t hasher;
+    uint32_t min_nodes;
+    bool stmts_only;
+    std::unordered_map<hash128_t, uint32_t, hash128_hasher_t> ids;
+    std::vector<shape_t> shapes;
+    std::vector<occurrence_t> occs;
+
+    // Scratch buffers reused across add() calls
+    std::vector<hash128_t> hashes;
+    std::vector<uint32_t> node_shape;
+    ctree_snapshot_t snap;
+
+public:
+    /**
+     * @param hash_flags CTH_* flags used to hash subtrees
+     * @param min_nodes Smallest subtree (in nodes) to index
+     * @param stmts_only Only index statement subtrees (cit_*)
+     */
+    explicit subtree_index_t(uint32_t hash_flags = CTH_NONE, uint32_t min_nodes = 4, bool stmts_only = false)
+        : hasher(hash_flags), min_nodes(std::max<uint32_t>(min_nodes, 1)), stmts_only(stmts_only) {}
+
+    /**
+     * @brief Index every subtree of a snapshot.
+     */
+    void add(const ctree_snapshot_t& s)
+    {
+        hasher.hash(s, hashes);
+        node_shape.assign(s.size(), UINT32_MAX);
+
+        // Pre-order: a parent is interned before any of its children
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            uint32_t nodes = s.end[i] - node_id_t(i);
+            auto op = s.op_of(node_id_t(i));
+            if (nodes < min_nodes || (stmts_only && op < cit_empty))
+                continue;
+
+            auto [p, inserted] = ids.try_emplace(hashes[i], uint32_t(shapes.size()));
+            if (inserted)
+                shapes.push_back(shape_t{hashes[i], nodes, uint8_t(op)});
+
+            uint32_t sid = p->second;
+            node_shape[i] = sid;
+            auto par = s.parent[i];
+            auto occ = uint32_t(occs.size());
+            occs.push_back(occurrence_t{s.func_ea, s.ea[i], node_id_t(i),
+                                        par == BAD_NODE_ID ? UINT32_MAX : node_shape[par],
+                                        UINT32_MAX});
+
+            auto& shape = shapes[sid];
+            if (shape.last == UINT32_MAX)
+                shape.first = occ;
+            else
+                occs[shape.last].next = occ;
+            shape.last = occ;
+            ++shape.count;
+        }
+    }
+
+    /**
+     * @brief Index every subtree of a decompiled function.
+     */
+    void add(cfunc_t* cfunc)
+    {
+        snap.build(cfunc, false);
+        add(snap);
+    }
+
+    /**
+     * @brief Find the shape of a hash.
+     *
+     * @return Shape, or nullptr if no indexed subtree has this hash
+     */
+    const shape_t* find(const hash128_t& h) const
+    {
+        auto p = ids.find(h);
+        return p == std::end(ids) ? nullptr : &shapes[p->second];
+    }
+
+    /**
+     * @brief Collect every occurrence of a shape.
+     */
+    occurrences_t occurrences(const shape_t& shape) const
+    {
+        occurrences_t out;
+        out.reserve(shape.count);
+        for (uint32_t o = shape.first; o != UINT32_MAX; o = occs[o].next)
+            out.push_back(&occs[o]);
+        return out;
+    }
+
+    /**
+     * @brief Enumerate maximal clone groups.
+     *
+     * A shape is reported when it occurs at least `min_count` times, unless
+     * every occurrence sits under the same repeated parent shape (in which case
+     * the parent is the clone worth reporting).
+     *
+     * @param min_count Minimum number of occurrences
+     * @param cb Callback receiving the shape and its occurrences; return false to stop
+     */
+    void for_each_clone(
+        uint32_t min_count,
+        std::function<bool(const shape_t&, const occurrences_t&)> cb) const
+    {
+        for (auto& shape : shapes)
+        {
+            if (shape.count < min_count)
+                continue;
+
+            auto occ = occurrences(shape);
+            uint32_t pshape = occ.front()->parent_shape;
+            bool subsumed = pshape != UINT32_MAX
+                         && shapes[pshape].count >= min_count
+                         && std::all_of(occ.begin(), occ.end(), [pshape](const occurrence_t* o)
+                            {
+                                return o->parent_shape == pshape;
+                            });
+            if (!subsumed && !cb(shape, occ))
+                return;
+        }
+    }
+
+    /// Number of distinct shapes
+    size_t shape_count() const { return shapes.size(); }
+
+    /// Number of indexed subtrees
+    size_t occurrence_count() const { return occs.size(); }
+
+    /// Approximate heap memory used by the index, in bytes
+    size_t memory_bytes() const
+    {
+        return shapes.capacity() * sizeof(shape_t)
+             + occs.capacity() * sizeof(occurrence_t)
+             + ids.size() * (sizeof(hash128_t) + sizeof(uint32_t) + 2 * sizeof(void*));
+    }
+
+    /**
+     * @brief Remove everything from the index.
+     */
+    void clear()
+    {
+        ids.clear();
+        shapes.clear();
+        occs.clear();
+    }
+};
+
+}  // namespace idacpp::hexrays
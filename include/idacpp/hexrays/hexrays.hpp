@@ -7,9 +7,13 @@ Hexrays utilities module - Decompiler support
 #pragma once
 
 #include <algorithm>
+#include <bitset>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <hexrays.hpp>
 
@@ -40,77 +44,656 @@ inline kernwin::update_state_ah_t default_enable_for_vd = FO_ACTION_UPDATE([],
     return vu == nullptr ? AST_DISABLE_FOR_WIDGET : AST_ENABLE;
 );
 
+//----------------------------------------------------------------------------------
+/// Dense index of a node in a flattened ctree
+using node_id_t = uint32_t;
+
+/// Invalid node index (e.g. the parent of a root)
+constexpr node_id_t BAD_NODE_ID = UINT32_MAX;
+
+/// Set of ctree item types (cot_* and cit_*)
+using ctype_set_t = std::bitset<cit_end>;
+
+/**
+ * @brief 64-bit FNV-1a hash of a C string.
+ *
+ * @param str String to hash (nullptr hashes as empty)
+ * @return Hash value
+ */
+inline uint64_t hash_cstr(const char* str)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    if (str != nullptr)
+    {
+        for (; *str != '\0'; ++str)
+        {
+            h ^= uint8_t(*str);
+            h *= 0x100000001B3ULL;
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Invoke a callback for each direct child of a ctree item.
+ *
+ * Children are reported in source order: conditions before branches, for-loop
+ * init/condition/step before the body, call object before the arguments,
+ * try body before each catch clause (caught expressions, then the handler
+ * statements).
+ *
+ * @param item Parent item
+ * @param f Callback taking a citem_t*
+ */
+template <typename F>
+inline void for_each_child(citem_t* item, F&& f)
+{
+    auto visit = [&f](citem_t* child) { f(child); };
+
+    if (item->is_expr())
+    {
+        auto e = (cexpr_t*)item;
+        if (e->op == cot_insn)
+        {
+            visit(e->insn);
+            return;
+        }
+        if (op_uses_x(e->op))
+            visit(e->x);
+        if (e->op == cot_call)
+        {
+            for (auto& arg : *e->a)
+                visit(&arg);
+            return;
+        }
+        if (op_uses_y(e->op))
+            visit(e->y);
+        if (op_uses_z(e->op))
+            visit(e->z);
+        return;
+    }
+
+    auto ins = (cinsn_t*)item;
+    switch (ins->op)
+    {
+        case cit_block:
+            for (auto& stmt : *ins->cblock)
+                visit(&stmt);
+            break;
+        case cit_expr:
+            visit(ins->cexpr);
+            break;
+        case cit_if:
+            visit(&ins->cif->expr);
+            visit(ins->cif->ithen);
+            if (ins->cif->ielse != nullptr)
+                visit(ins->cif->ielse);
+            break;
+        case cit_for:
+            visit(&ins->cfor->init);
+            visit(&ins->cfor->expr);
+            visit(&ins->cfor->step);
+            visit(ins->cfor->body);
+            break;
+        case cit_while:
+            visit(&ins->cwhile->expr);
+            visit(ins->cwhile->body);
+            break;
+        case cit_do:
+            visit(ins->cdo->body);
+            visit(&ins->cdo->expr);
+            break;
+        case cit_switch:
+            visit(&ins->cswitch->expr);
+            for (auto& ccase : ins->cswitch->cases)
+                visit(&ccase);
+            break;
+        case cit_return:
+            visit(&ins->creturn->expr);
+            break;
+        case cit_try:
+            for (auto& stmt : *ins->ctry)
+                visit(&stmt);
+            for (auto& ccatch : ins->ctry->catchs)
+            {
+                for (auto& cexpr : ccatch.exprs)
+                    visit(&cexpr.obj);
+                for (auto& stmt : ccatch)
+                    visit(&stmt);
+            }
+            break;
+        case cit_throw:
+            visit(&ins->cthrow->expr);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Invoke a callback for each statement list a ctree item owns.
+ *
+ * A block owns its cblock_t; a try statement owns its body and one list per
+ * catch clause. Other items own none.
+ *
+ * @param item Item
+ * @param f Callback taking a cblock_t*
+ */
+template <typename F>
+inline void for_each_stmt_block(citem_t* item, F&& f)
+{
+    if (item->op == cit_block)
+    {
+        f(((cinsn_t*)item)->cblock);
+    }
+    else if (item->op == cit_try)
+    {
+        ctry_t* ctry = ((cinsn_t*)item)->ctry;
+        f(static_cast<cblock_t*>(ctry));
+        for (auto& ccatch : ctry->catchs)
+            f(static_cast<cblock_t*>(&ccatch));
+    }
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Position of a statement inside its containing block.
+ */
+struct stmt_block_pos_t
+{
+    cblock_t* block = nullptr;   ///< Containing block
+    cblock_t::iterator pos;      ///< Iterator to the statement inside the block
+    size_t ordinal = 0;          ///< Zero-based index of the statement in the block
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Summary of what occurs in a subtree.
+ *
+ * Records every item type present in the subtree (root included) and a small
+ * Bloom filter of the objects (cot_obj) and helpers (cot_helper) it references.
+ * The Bloom filter may report false positives, never false negatives.
+ */
+struct ctree_summary_t
+{
+    ctype_set_t ops;      ///< Item types present in the subtree
+    uint64_t refs = 0;    ///< Bloom filter of referenced objects and helpers
+
+    /// Bloom filter bits for a reference key
+    static uint64_t ref_bits(uint64_t key)
+    {
+        key *= 0x9E3779B97F4A7C15ULL;
+        return (1ULL << (key >> 58)) | (1ULL << ((key >> 52) & 63));
+    }
+
+    /// Record a reference to an object address
+    void add_obj(ea_t ea) { refs |= ref_bits(ea); }
+
+    /// Record a reference to a helper by name
+    void add_helper(const char* name) { refs |= ref_bits(hash_cstr(name)); }
+
+    /// Check whether the subtree may reference an object address
+    bool may_reference_obj(ea_t ea) const { auto b = ref_bits(ea); return (refs & b) == b; }
+
+    /// Check whether the subtree may reference a helper
+    bool may_reference_helper(const char* name) const { auto b = ref_bits(hash_cstr(name)); return (refs & b) == b; }
+
+    /// Check whether any of the given item types occurs in the subtree
+    bool has_any(const ctype_set_t& wanted) const { return (ops & wanted).any(); }
+
+    ctree_summary_t& operator|=(const ctree_summary_t& r)
+    {
+        ops |= r.ops;
+        refs |= r.refs;
+        return *this;
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Compact map from ctree items to dense 32-bit node ids.
+ *
+ * Open addressing over a slot array that holds only node ids: the key is
+ * read back from the caller's items array, so the map costs 4 bytes per slot
+ * (about 6-12 bytes per item) instead of a hash node per item.
+ */
+class item_id_map_t
+{
+private:
+    std::vector<node_id_t> slots;
+    uint32_t shift = 64;
+
+    size_t home(const citem_t* item) const
+    {
+        return size_t((uint64_t(uintptr_t(item)) * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+public:
+    /**
+     * @brief Index every item by its position.
+     *
+     * @param items Items; node i is items[i] (must outlive the map's use)
+     */
+    void build(const std::vector<citem_t*>& items)
+    {
+        size_t cap = 8;
+        uint32_t bits = 3;
+        while (cap < items.size() + items.size() / 2 + 1)
+        {
+            cap <<= 1;
+            ++bits;
+        }
+        slots.assign(cap, BAD_NODE_ID);
+        shift = 64 - bits;
+        size_t mask = cap - 1;
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            size_t h = home(items[i]);
+            while (slots[h] != BAD_NODE_ID)
+                h = (h + 1) & mask;
+            slots[h] = node_id_t(i);
+        }
+    }
+
+    /**
+     * @brief Find the node of an item.
+     *
+     * @param items The array passed to build()
+     * @param item Item to look up
+     * @return Node, or BAD_NODE_ID if the item is not indexed
+     */
+    node_id_t find(const std::vector<citem_t*>& items, const citem_t* item) const
+    {
+        if (slots.empty())
+            return BAD_NODE_ID;
+        size_t mask = slots.size() - 1;
+        for (size_t h = home(item);; h = (h + 1) & mask)
+        {
+            node_id_t id = slots[h];
+            if (id == BAD_NODE_ID || items[id] == item)
+                return id;
+        }
+    }
+
+    /// Remove all entries
+    void clear()
+    {
+        slots.clear();
+        shift = 64;
+    }
+
+    /// Heap memory used by the map, in bytes
+    size_t memory_bytes() const { return slots.capacity() * sizeof(node_id_t); }
+};
+
+//----------------------------------------------------------------------------------
+// ctreeparent_visitor_t index facets:
+#define CPF_NONE        0x00  ///< No facet
+#define CPF_PARENTS     0x01  ///< Node ids and parent of every item (built with any facet)
+#define CPF_EA          0x02  ///< Expressions sorted by EA
+#define CPF_INTERVALS   0x04  ///< Pre-order subtree intervals (O(1) ancestor checks)
+#define CPF_DEPTH       0x08  ///< Depth of every item
+#define CPF_BLOCKPOS    0x10  ///< Block position of every statement inside a cblock_t
+#define CPF_SUMMARIES   0x20  ///< Per-subtree ctree_summary_t
+#define CPF_ALL         0x3F  ///< Every facet
+
 //----------------------------------------------------------------------------------
 /**
  * @brief Enhanced ctree visitor with parent tracking and EA mapping.
  *
- * Extends ctree_parentee_t to build and maintain maps of parent relationships
- * and effective address to item mappings during tree traversal.
+ * The index is split into facets (CPF_*) that are materialized lazily: each
+ * query builds its facet the first time it is needed, and ensure() builds
+ * several at once. The tree is walked once to assign every item a dense
+ * 32-bit node id; all other facets are parallel arrays indexed by node id and
+ * are computed by linear sweeps without walking the tree again. Children are
+ * not stored: they are the nodes of the interval whose parent is the node.
+ * size(), memory_bytes() and bytes_per_node() report the index footprint.
+ *
+ * apply_to() only records the root (and its parent) and builds the facets
+ * passed to the constructor; it does not visit the whole tree (visit_expr()
+ * and visit_insn() prune the root's children) and returns 0. The class is
+ * final: per-node work belongs in a separate ctree_visitor_t or in a loop
+ * over the facets. Call reset() or apply_to() again after the ctree is
+ * modified. Statements of try bodies and catch clauses have block
+ * positions like those of ordinary blocks.
+ *
+ * Facets are built on first use by const accessors, so even a const index
+ * must not be queried from several threads at once unless ensure() built
+ * every needed facet beforehand.
+ *
+ * @example
+ * @code
+ * ctreeparent_visitor_t index;
+ * index.apply_to(&cfunc->body, nullptr);   // O(1)
+ * auto p = index.parent_of(item);          // builds the parents facet only
+ * index.ensure(CPF_EA | CPF_BLOCKPOS);     // one pass for both
+ * @endcode
  */
-class ctreeparent_visitor_t : public ctree_parentee_t
+class ctreeparent_visitor_t final : public ctree_parentee_t
 {
 private:
-    std::map<const citem_t*, const citem_t*> parent;   ///< Parent map
-    std::map<const ea_t, const citem_t*> ea2item;      ///< EA to item map
+    uint32_t eager;                        ///< Facets built by apply_to()
+    citem_t* root = nullptr;               ///< Indexed subtree
+    const citem_t* root_parent = nullptr;  ///< Parent of the root, as given to apply_to()
+
+    mutable uint32_t built = CPF_NONE;                 ///< Materialized facets
+    mutable item_id_map_t ids;                         ///< Item to pre-order node
+    mutable std::vector<citem_t*> items;               ///< Items in pre-order (node to item)
+    mutable std::vector<node_id_t> parent_ids;         ///< Parent node (CPF_PARENTS)
+    mutable std::vector<node_id_t> ends;               ///< Subtree end (CPF_INTERVALS)
+    mutable std::vector<uint32_t> depths;              ///< Depth (CPF_DEPTH)
+    mutable std::vector<ctree_summary_t> summaries;    ///< Summaries (CPF_SUMMARIES)
+    mutable std::vector<node_id_t> ea_order;           ///< Expression nodes sorted by EA, then node (CPF_EA)
+    mutable std::vector<uint32_t> blockpos_slot;       ///< Node to blockpos index, or UINT32_MAX (CPF_BLOCKPOS)
+    mutable std::vector<stmt_block_pos_t> blockpos;    ///< Positions of statements inside blocks (CPF_BLOCKPOS)
+
+    void build(uint32_t want) const
+    {
+        want &= ~built;
+        if (want == CPF_NONE || root == nullptr)
+            return;
+
+        // Node ids and parents come first: every other facet is keyed by them
+        if ((built & CPF_PARENTS) == 0)
+        {
+            want |= CPF_PARENTS;
+            struct pending_t
+            {
+                citem_t* item;
+                node_id_t parent;
+            };
+            std::vector<pending_t> stack{{root, BAD_NODE_ID}};
+            std::vector<citem_t*> children;
+            while (!stack.empty())
+            {
+                auto [item, par] = stack.back();
+                stack.pop_back();
+
+                auto id = node_id_t(items.size());
+                items.push_back(item);
+                parent_ids.push_back(par);
+
+                children.clear();
+                for_each_child(item, [&children](citem_t* child) { children.push_back(child); });
+                for (auto p = children.rbegin(); p != children.rend(); ++p)
+                    stack.push_back(pending_t{*p, id});
+            }
+            ids.build(items);
+        }
+
+        size_t n = items.size();
+        if ((want & CPF_EA) != 0)
+        {
+            ea_order.clear();
+            for (size_t i = 0; i < n; ++i)
+                if (items[i]->is_expr())
+                    ea_order.push_back(node_id_t(i));
+            std::stable_sort(ea_order.begin(), ea_order.end(), [this](node_id_t a, node_id_t b)
+            {
+                return items[a]->ea < items[b]->ea;
+            });
+        }
+        if ((want & CPF_BLOCKPOS) != 0)
+        {
+            blockpos_slot.assign(n, UINT32_MAX);
+            blockpos.clear();
+            for (size_t i = 0; i < n; ++i)
+            {
+                for_each_stmt_block(items[i], [this](cblock_t* cblock)
+                {
+                    size_t ordinal = 0;
+                    for (auto p = cblock->begin(); p != cblock->end(); ++p, ++ordinal)
+                    {
+                        auto id = ids.find(items, &*p);
+                        if (id == BAD_NODE_ID)
+                            continue;
+                        blockpos_slot[id] = uint32_t(blockpos.size());
+                        blockpos.push_back(stmt_block_pos_t{cblock, p, ordinal});
+                    }
+                });
+            }
+        }
+        if ((want & CPF_INTERVALS) != 0)
+        {
+            ends.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                ends[i] = node_id_t(i + 1);
+            for (size_t i = n; i-- > 1;)
+                ends[parent_ids[i]] = std::max(ends[parent_ids[i]], ends[i]);
+        }
+        if ((want & CPF_DEPTH) != 0)
+        {
+            depths.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                depths[i] = parent_ids[i] == BAD_NODE_ID ? 0 : depths[parent_ids[i]] + 1;
+        }
+        if ((want & CPF_SUMMARIES) != 0)
+        {
+            summaries.assign(n, ctree_summary_t());
+            for (size_t i = n; i-- > 0;)
+            {
+                auto& sm = summaries[i];
+                sm.ops.set(items[i]->op);
+                if (items[i]->op == cot_obj)
+                    sm.add_obj(((const cexpr_t*)items[i])->obj_ea);
+                else if (items[i]->op == cot_helper)
+                    sm.add_helper(((const cexpr_t*)items[i])->helper);
+                if (parent_ids[i] != BAD_NODE_ID)
+                    summaries[parent_ids[i]] |= sm;
+            }
+        }
+        built |= want;
+    }
+
+    node_id_t id_of(const citem_t* item) const
+    {
+        return ids.find(items, item);
+    }
+
+    int on_root(citem_t* item)
+    {
+        set_root(item, parents.empty() ? nullptr : parents.back());
+        ensure(eager);
+        // The facets are built by our own pass: skip the rest of the SDK traversal
+        prune_now();
+        return 0;
+    }
 
 public:
     /**
-     * @brief Visit expression node.
+     * @brief Construct the index.
+     *
+     * @param eager CPF_* facets to build as soon as apply_to() is called
+     */
+    explicit ctreeparent_visitor_t(uint32_t eager = CPF_NONE) : eager(eager) {}
+
+    /**
+     * @brief Called by apply_to() for the root item.
      */
     int idaapi visit_expr(cexpr_t* e) override
     {
-        ea2item[e->ea] = parent[e] = parent_expr();
-        return 0;
+        return on_root(e);
     }
 
     /**
-     * @brief Visit instruction node.
+     * @brief Called by apply_to() for the root item.
      */
     int idaapi visit_insn(cinsn_t* ins) override
     {
-        parent[ins] = parent_insn();
-        return 0;
+        return on_root(ins);
+    }
+
+    /**
+     * @brief Index a subtree without running a traversal; facets are built on demand.
+     *
+     * @param item Root item
+     * @param parent Parent of the root item (optional)
+     */
+    void set_root(citem_t* item, const citem_t* parent = nullptr)
+    {
+        reset();
+        root = item;
+        root_parent = parent;
+    }
+
+    /**
+     * @brief Drop every materialized facet. The root is kept.
+     */
+    void reset()
+    {
+        built = CPF_NONE;
+        ids.clear();
+        items.clear();
+        parent_ids.clear();
+        ends.clear();
+        depths.clear();
+        summaries.clear();
+        ea_order.clear();
+        blockpos_slot.clear();
+        blockpos.clear();
+    }
+
+    /**
+     * @brief Build the given facets (in one pass) if they are not built yet.
+     *
+     * @param facets CPF_* flags
+     */
+    void ensure(uint32_t facets) const
+    {
+        build(facets);
     }
 
+    /// CPF_* facets materialized so far
+    uint32_t facets() const { return built; }
+
     /**
-     * @brief Get parent of a tree item.
+     * @brief Get the summary of a subtree (CPF_SUMMARIES).
+     *
+     * @param item Subtree root
+     * @return Summary, or nullptr if the item is not indexed
+     */
+    const ctree_summary_t* summary_of(const citem_t* item) const
+    {
+        build(CPF_SUMMARIES);
+        auto id = id_of(item);
+        return id == BAD_NODE_ID ? nullptr : &summaries[id];
+    }
+
+    /**
+     * @brief Check whether a subtree may contain any of the given item types.
+     *
+     * @return false only if the subtree certainly contains none of them
+     */
+    bool may_contain(const citem_t* item, const ctype_set_t& ops) const
+    {
+        auto s = summary_of(item);
+        return s == nullptr || s->has_any(ops);
+    }
+
+    /**
+     * @brief Get parent of a tree item (CPF_PARENTS).
      *
      * @param item Tree item
      * @return Parent item, or nullptr if root
      */
-    const citem_t* parent_of(const citem_t* item)
+    const citem_t* parent_of(const citem_t* item) const
     {
-        return parent[item];
+        build(CPF_PARENTS);
+        auto id = id_of(item);
+        if (id == BAD_NODE_ID)
+            return nullptr;
+        auto par = parent_ids[id];
+        return par == BAD_NODE_ID ? root_parent : items[par];
     }
 
     /**
-     * @brief Find tree item by effective address.
+     * @brief Get the depth of a tree item (CPF_DEPTH).
+     *
+     * @return Depth (0 for the root), or -1 if the item is not indexed
+     */
+    int depth_of(const citem_t* item) const
+    {
+        build(CPF_DEPTH);
+        auto id = id_of(item);
+        return id == BAD_NODE_ID ? -1 : int(depths[id]);
+    }
+
+    /**
+     * @brief Find tree item by effective address (CPF_EA).
      *
      * @param ea Effective address
      * @return Tree item at EA, or nullptr if not found
      */
     const citem_t* by_ea(ea_t ea) const
     {
-        auto p = ea2item.find(ea);
-        return p == std::end(ea2item) ? nullptr : p->second;
+        build(CPF_EA);
+        // Last expression in pre-order at this EA
+        auto p = std::upper_bound(ea_order.begin(), ea_order.end(), ea, [this](ea_t x, node_id_t id)
+        {
+            return x < items[id]->ea;
+        });
+        if (p == ea_order.begin() || items[*(p - 1)]->ea != ea)
+            return nullptr;
+        return items[*(p - 1)];
+    }
+
+    /**
+     * @brief Get the block position of a statement in O(1) (CPF_BLOCKPOS).
+     *
+     * @param stmt_item Statement item
+     * @return Block position, or nullptr if the statement is not directly inside a block
+     */
+    const stmt_block_pos_t* block_pos_of(const citem_t* stmt_item) const
+    {
+        build(CPF_BLOCKPOS);
+        auto id = id_of(stmt_item);
+        if (id == BAD_NODE_ID || blockpos_slot[id] == UINT32_MAX)
+            return nullptr;
+        return &blockpos[blockpos_slot[id]];
     }
 
     /**
-     * @brief Check if parent_item is ancestor of item.
+     * @brief Check if parent_item is ancestor of item in O(1) (CPF_INTERVALS).
      *
      * @param parent_item Potential ancestor
      * @param item Child item to check
      * @return true if parent_item is an ancestor of item
      */
-    bool is_ancestor_of(const citem_t* parent_item, const citem_t* item)
+    bool is_ancestor_of(const citem_t* parent_item, const citem_t* item) const
     {
-        while (item != nullptr)
-        {
-            item = parent_of(item);
-            if (item == parent_item)
-                return true;
-        }
-        return false;
+        build(CPF_INTERVALS);
+        auto a = id_of(parent_item);
+        auto b = id_of(item);
+        if (b == BAD_NODE_ID)
+            return false;
+        if (a == BAD_NODE_ID)
+            return parent_item != nullptr && parent_item == root_parent;
+        return a < b && b < ends[a];
+    }
+
+    /// Number of indexed items (0 until a facet is built)
+    size_t size() const { return items.size(); }
+
+    /**
+     * @brief Heap memory used by the materialized facets, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return ids.memory_bytes()
+             + items.capacity() * sizeof(citem_t*)
+             + parent_ids.capacity() * sizeof(node_id_t)
+             + ends.capacity() * sizeof(node_id_t)
+             + depths.capacity() * sizeof(uint32_t)
+             + summaries.capacity() * sizeof(ctree_summary_t)
+             + ea_order.capacity() * sizeof(node_id_t)
+             + blockpos_slot.capacity() * sizeof(uint32_t)
+             + blockpos.capacity() * sizeof(stmt_block_pos_t);
+    }
+
+    /// Heap bytes per indexed item
+    double bytes_per_node() const
+    {
+        return items.empty() ? 0.0 : double(memory_bytes()) / double(items.size());
     }
 };
 
@@ -222,7 +805,7 @@ inline const cinsn_t* get_stmt_insn(
  * @param stmt_item Statement item
  * @param p_cblock Output parameter for containing block
  * @param p_pos Output parameter for position in block
- * @param helper Optional parent visitor
+ * @param helper Optional parent visitor (answers in O(1) instead of walking the block)
  * @return true if found, false otherwise
  */
 inline bool get_stmt_block_pos(
@@ -232,26 +815,103 @@ inline bool get_stmt_block_pos(
     cblock_t::iterator* p_pos,
     ctreeparent_visitor_t* helper = nullptr)
 {
-    auto func_body = &cfunc->body;
-    auto cblock_insn = (cinsn_t*)(
-        helper == nullptr ? func_body->find_parent_of(stmt_item)
-                          : helper->parent_of(stmt_item));
+    if (helper != nullptr)
+    {
+        auto bpos = helper->block_pos_of(stmt_item);
+        if (bpos == nullptr)
+            return false;
 
-    if (cblock_insn == nullptr || cblock_insn->op != cit_block)
-        return false;
+        *p_pos = bpos->pos;
+        *p_cblock = bpos->block;
+        return true;
+    }
 
-    cblock_t* cblock = cblock_insn->cblock;
+    auto func_body = &cfunc->body;
+    auto owner = func_body->find_parent_of(stmt_item);
+    if (owner == nullptr)
+        return false;
 
-    for (auto p = cblock->begin(); p != cblock->end(); ++p)
+    bool found = false;
+    for_each_stmt_block(owner, [&](cblock_t* cblock)
     {
-        if (&*p == stmt_item)
+        for (auto p = cblock->begin(); p != cblock->end() && !found; ++p)
         {
-            *p_pos = p;
-            *p_cblock = cblock;
-            return true;
+            if (&*p == stmt_item)
+            {
+                *p_pos = p;
+                *p_cblock = cblock;
+                found = true;
+            }
         }
+    });
+    return found;
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Statements of a single block, ordered by their position in the block.
+ */
+struct stmt_block_group_t
+{
+    cblock_t* block = nullptr;                ///< Containing block
+    std::vector<stmt_block_pos_t> stmts;      ///< Statement positions, sorted by ordinal
+};
+
+/// Statement groups, in the order their blocks were first seen
+using stmt_block_groups_t = std::vector<stmt_block_group_t>;
+
+/**
+ * @brief Group many statements by their containing block.
+ *
+ * Statements that are not directly inside a block are skipped, and duplicates
+ * are reported once. Runs in O(n log n) over the statement list once the
+ * parent visitor is built.
+ *
+ * @param cfunc Decompiled function
+ * @param stmts Statements to group
+ * @param helper Optional parent visitor (built on the fly if nullptr)
+ * @return Groups of statement positions, one per block
+ */
+inline stmt_block_groups_t group_stmts_by_block(
+    cfunc_t* cfunc,
+    const cinsnptrvec_t& stmts,
+    ctreeparent_visitor_t* helper = nullptr)
+{
+    ctreeparent_visitor_t local_helper;
+    if (helper == nullptr)
+    {
+        local_helper.apply_to(&cfunc->body, nullptr);
+        helper = &local_helper;
     }
-    return false;
+
+    stmt_block_groups_t groups;
+    std::unordered_map<const cblock_t*, size_t> group_idx;
+    for (auto stmt : stmts)
+    {
+        auto bpos = helper->block_pos_of(stmt);
+        if (bpos == nullptr)
+            continue;
+
+        auto [p, inserted] = group_idx.try_emplace(bpos->block, groups.size());
+        if (inserted)
+            groups.push_back(stmt_block_group_t{bpos->block, {}});
+
+        groups[p->second].stmts.push_back(*bpos);
+    }
+
+    for (auto& group : groups)
+    {
+        auto& v = group.stmts;
+        std::sort(v.begin(), v.end(), [](const stmt_block_pos_t& a, const stmt_block_pos_t& b)
+        {
+            return a.ordinal < b.ordinal;
+        });
+        v.erase(std::unique(v.begin(), v.end(), [](const stmt_block_pos_t& a, const stmt_block_pos_t& b)
+        {
+            return a.ordinal == b.ordinal;
+        }), v.end());
+    }
+    return groups;
 }
 
 //----------------------------------------------------------------------------------
@@ -337,4 +997,55 @@ inline void find_expr(
     v.apply_to(&func->body, parent);
 }
 
+/**
+ * @brief Find expressions of given types, skipping subtrees that cannot match.
+ *
+ * Uses the subtree summaries (CPF_SUMMARIES, built on first use) of a parent
+ * visitor to prune every subtree containing none of the wanted item types.
+ * Items outside the indexed subtree are never pruned.
+ *
+ * @param func Decompiled function
+ * @param ops Wanted expression types
+ * @param cb Callback invoked for each matching expression (return 0 to continue, non-zero to stop)
+ * @param index Parent visitor applied to the same function
+ * @param parent Starting parent item (nullptr for entire function)
+ */
+inline void find_expr(
+    cfuncptr_t func,
+    const ctype_set_t& ops,
+    std::function<int(cexpr_t*)> cb,
+    const ctreeparent_visitor_t& index,
+    citem_t* parent = nullptr)
+{
+    struct pruning_visitor_t : public ctree_visitor_t
+    {
+        const ctype_set_t& ops;
+        std::function<int(cexpr_t*)>& cb;
+        const ctreeparent_visitor_t& index;
+
+        pruning_visitor_t(const ctype_set_t& ops, std::function<int(cexpr_t*)>& cb, const ctreeparent_visitor_t& index)
+            : ctree_visitor_t(CV_FAST), ops(ops), cb(cb), index(index) {}
+
+        int idaapi visit_insn(cinsn_t* ins) override
+        {
+            if (!index.may_contain(ins, ops))
+                prune_now();
+            return 0;
+        }
+
+        int idaapi visit_expr(cexpr_t* e) override
+        {
+            if (!index.may_contain(e, ops))
+            {
+                prune_now();
+                return 0;
+            }
+            return ops.test(e->op) ? cb(e) : 0;
+        }
+    };
+
+    pruning_visitor_t v(ops, cb, index);
+    v.apply_to(&func->body, parent);
+}
+
 }  // namespace idacpp::hexrays
@@ -0,0 +1,218 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Stable structural node identifiers
+*/
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+
+namespace idacpp::hexrays
+{
+
+/// Deterministic node identifier that survives re-decompilation
+using stable_id_t = uint64_t;
+
+/// Invalid stable identifier
+constexpr stable_id_t BAD_STABLE_ID = 0;
+
+namespace ids_detail
+{
+    inline uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Compute the stable identifier of every node of a snapshot.
+ *
+ * The identifier hashes the node's structural path (item type and child
+ * ordinal of every node from the root) together with its own address. The
+ * same code decompiled twice yields the same identifiers, whether computed
+ * from a live tree or from a persisted snapshot. An edit only changes the
+ * identifiers of the nodes below it and of later siblings along its path;
+ * use ctree_diff_t to rematch those.
+ *
+ * @param snap Snapshot (live item pointers are not needed)
+ * @param out Output identifiers, indexed by node_id_t
+ */
+inline void compute_stable_ids(const ctree_snapshot_t& snap, std::vector<stable_id_t>& out)
+{
+    size_t n = snap.size();
+    out.resize(n);
+    std::vector<uint32_t> next_ordinal(n, 0);
+
+    // Pre-order: each parent's path hash is ready before its children
+    for (size_t i = 0; i < n; ++i)
+    {
+        node_id_t par = snap.parent[i];
+        uint64_t op = snap.op[i];
+        if (par == BAD_NODE_ID)
+        {
+            out[i] = ids_detail::mix(0x6A09E667F3BCC908ULL ^ op);
+        }
+        else
+        {
+            uint64_t ordinal = next_ordinal[par]++;
+            out[i] = ids_detail::mix(out[par] + (ordinal << 8 | op) * 0x9E3779B97F4A7C15ULL);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        stable_id_t id = ids_detail::mix(out[i] ^ (uint64_t(snap.ea[i]) * 0xC2B2AE3D27D4EB4FULL));
+        out[i] = id == BAD_STABLE_ID ? 1 : id;
+    }
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Two-way map between stable identifiers and live ctree items.
+ *
+ * Rebuild it after each decompilation; data cached under stable identifiers
+ * (analysis results, highlights, persisted snapshots) then resolves to the
+ * new items without rematching. Both directions are O(1) hash lookups.
+ *
+ * @example
+ * @code
+ * stable_id_index_t ids;
+ * ids.build(cfunc);
+ * stable_id_t key = ids.id_of(vu->item.e);   // remember this
+ * // ... refresh_view(true) ...
+ * ids.build(vu->cfunc);
+ * citem_t* again = ids.item_of(key);
+ * @endcode
+ */
+class stable_id_index_t
+{
+private:
+    std::vector<stable_id_t> ids;
+    std::vector<citem_t*> items;
+    std::unordered_map<stable_id_t, node_id_t> by_id;
+    item_id_map_t by_item;
+
+public:
+    /**
+     * @brief Index a decompiled function.
+     */
+    void build(cfunc_t* cfunc)
+    {
+        ctree_snapshot_t snap;
+        snap.build(cfunc);
+        build(snap);
+    }
+
+    /**
+     * @brief Index a snapshot.
+     *
+     * Item lookups are only available if the snapshot has live item pointers.
+     * Identifiers that collide (a 64-bit hash collision) are rehashed in
+     * pre-order, which keeps them deterministic.
+     */
+    void build(const ctree_snapshot_t& snap)
+    {
+        clear();
+        compute_stable_ids(snap, ids);
+        items = snap.items;
+        by_id.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            while (!by_id.emplace(ids[i], node_id_t(i)).second)
+            {
+                ids[i] = ids_detail::mix(ids[i]);
+                if (ids[i] == BAD_STABLE_ID)
+                    ids[i] = 1;
+            }
+        }
+        by_item.build(items);
+    }
+
+    /**
+     * @brief Remove all entries.
+     */
+    void clear()
+    {
+        ids.clear();
+        items.clear();
+        by_id.clear();
+        by_item.clear();
+    }
+
+    /// Number of indexed nodes
+    size_t size() const { return ids.size(); }
+
+    /// Stable identifier of a node
+    stable_id_t id_of_node(node_id_t n) const { return n < ids.size() ? ids[n] : BAD_STABLE_ID; }
+
+    /**
+     * @brief Get the node of a stable identifier.
+     *
+     * @return Node, or BAD_NODE_ID if the identifier is not in this tree
+     */
+    node_id_t node_of(stable_id_t id) const
+    {
+        auto p = by_id.find(id);
+        return p == by_id.end() ? BAD_NODE_ID : p->second;
+    }
+
+    /**
+     * @brief Get the stable identifier of a live item.
+     *
+     * @return Identifier, or BAD_STABLE_ID if the item is not indexed
+     */
+    stable_id_t id_of(const citem_t* item) const
+    {
+        node_id_t n = by_item.find(items, item);
+        return n == BAD_NODE_ID ? BAD_STABLE_ID : ids[n];
+    }
+
+    /**
+     * @brief Get the live item of a stable identifier.
+     *
+     * @return Item, or nullptr if the identifier is not in this tree
+     */
+    citem_t* item_of(stable_id_t id) const
+    {
+        node_id_t n = node_of(id);
+        return (n == BAD_NODE_ID || n >= items.size()) ? nullptr : items[n];
+    }
+
+    /// Every identifier, indexed by node_id_t
+    const std::vector<stable_id_t>& all_ids() const { return ids; }
+
+    /**
+     * @brief Approximate heap memory used by the index, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        // Hash nodes: key, value and next pointer, plus one bucket pointer
+        constexpr size_t id_node = sizeof(stable_id_t) + sizeof(node_id_t) + 2 * sizeof(void*);
+        return ids.capacity() * sizeof(stable_id_t)
+             + items.capacity() * sizeof(citem_t*)
+             + by_id.size() * id_node + by_id.bucket_count() * sizeof(void*)
+             + by_item.memory_bytes();
+    }
+
+    /// Heap bytes per indexed node
+    double bytes_per_node() const
+    {
+        return ids.empty() ? 0.0 : double(memory_bytes()) / double(ids.size());
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,264 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Local variable use/def index
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+// Local variable occurrence kinds (bit flags)
+#define LVR_USE       0x01   ///< The value is read
+#define LVR_DEF       0x02   ///< The variable (or a member of it) is written
+#define LVR_ADDR      0x04   ///< The address is taken (&v, &v.field)
+#define LVR_CALLARG   0x08   ///< Passed as a call argument (always with LVR_USE)
+#define LVR_ANY       0xFF   ///< Any kind
+
+/**
+ * @brief One occurrence of a local variable in the ctree.
+ */
+struct lvar_occurrence_t
+{
+    cexpr_t* expr;     ///< The cot_var expression
+    cinsn_t* stmt;     ///< Innermost statement containing the expression
+    uint8_t kind;      ///< LVR_* flags
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Index from local variable number to every cot_var occurrence.
+ *
+ * Built in one explicit-stack pass over the ctree. Occurrences are grouped by
+ * variable in a flat array (CSR layout: `offsets[idx]..offsets[idx+1]`), in
+ * tree order within each variable, so every query is a slice lookup.
+ *
+ * Classification is syntactic:
+ * - `v = ...` is a def; `v += ...`, `v++` are def and use
+ * - writes through a member (`v.f = ...`) count as defs of v
+ * - `&v` and `&v.f` mark the variable address-taken
+ * - `f(v)` is a use in a call argument
+ * - everything else is a use
+ *
+ * Item pointers are only valid while the source cfunc_t is alive and unchanged;
+ * rebuild after the ctree is modified.
+ *
+ * @example
+ * @code
+ * lvar_index_t index;
+ * index.build(cfunc);
+ * for (auto& occ : index.occurrences(e->v.idx))
+ *     if (occ.kind & LVR_DEF)
+ *         msg("%a: def\n", occ.stmt->ea);
+ * @endcode
+ */
+class lvar_index_t
+{
+private:
+    std::vector<uint32_t> offsets;            ///< Start of each variable's occurrences (size = var_count() + 1)
+    std::vector<lvar_occurrence_t> occs;      ///< Occurrences grouped by variable
+    std::vector<uint8_t> var_kinds;           ///< Union of the occurrence kinds, per variable
+
+    /// Kind that applies to a cot_var child of an expression
+    static uint8_t child_kind(const cexpr_t* e, const citem_t* child, uint8_t own_kind)
+    {
+        if (is_assignment(e->op) && child == e->x)
+            return e->op == cot_asg ? LVR_DEF : (LVR_DEF | LVR_USE);
+        if (is_prepost(e->op))
+            return LVR_DEF | LVR_USE;
+        switch (e->op)
+        {
+            case cot_ref:
+                return LVR_ADDR;
+            case cot_memref:
+                // Member access inherits what happens to the member
+                return child == e->x ? own_kind : LVR_USE;
+            case cot_call:
+                return child == e->x ? LVR_USE : (LVR_USE | LVR_CALLARG);
+            default:
+                return LVR_USE;
+        }
+    }
+
+public:
+    /**
+     * @brief Build the index for a decompiled function.
+     *
+     * @param cfunc Decompiled function
+     */
+    void build(cfunc_t* cfunc)
+    {
+        build(&cfunc->body, cfunc->get_lvars()->size());
+    }
+
+    /**
+     * @brief Build the index for an arbitrary subtree.
+     *
+     * @param root Root item
+     * @param nvars Number of local variables (grown to fit the largest index seen)
+     */
+    void build(citem_t* root, size_t nvars = 0)
+    {
+        struct pending_t
+        {
+            citem_t* item;
+            cinsn_t* stmt;
+            uint8_t kind;
+        };
+
+        struct raw_t
+        {
+            int idx;
+            lvar_occurrence_t occ;
+        };
+
+        std::vector<raw_t> raw;
+        std::vector<pending_t> stack{{root, nullptr, LVR_USE}};
+        std::vector<citem_t*> children;
+
+        while (!stack.empty())
+        {
+            auto [item, stmt, kind] = stack.back();
+            stack.pop_back();
+
+            if (item->op == cot_var)
+            {
+                auto e = (cexpr_t*)item;
+                raw.push_back(raw_t{e->v.idx, lvar_occurrence_t{e, stmt, kind}});
+                nvars = std::max(nvars, size_t(e->v.idx) + 1);
+                continue;
+            }
+
+            children.clear();
+            for_each_child(item, [&children](citem_t* child) { children.push_back(child); });
+            if (item->is_expr())
+            {
+                auto e = (cexpr_t*)item;
+                for (auto p = children.rbegin(); p != children.rend(); ++p)
+                    stack.push_back(pending_t{*p, stmt, child_kind(e, *p, kind)});
+            }
+            else
+            {
+                for (auto p = children.rbegin(); p != children.rend(); ++p)
+                    stack.push_back(pending_t{*p, (cinsn_t*)item, LVR_USE});
+            }
+        }
+
+        // Counting sort by variable keeps tree order within each variable
+        offsets.assign(nvars + 1, 0);
+        var_kinds.assign(nvars, 0);
+        for (auto& r : raw)
+        {
+            ++offsets[r.idx + 1];
+            var_kinds[r.idx] |= r.occ.kind;
+        }
+        for (size_t i = 1; i <= nvars; ++i)
+            offsets[i] += offsets[i - 1];
+
+        occs.resize(raw.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (auto& r : raw)
+            occs[fill[r.idx]++] = r.occ;
+    }
+
+    /**
+     * @brief Remove all entries.
+     */
+    void clear()
+    {
+        offsets.clear();
+        occs.clear();
+        var_kinds.clear();
+    }
+
+    /// Number of indexed variables
+    size_t var_count() const { return var_kinds.size(); }
+
+    /// Total number of occurrences
+    size_t size() const { return occs.size(); }
+
+    /**
+     * @brief Get every occurrence of a variable, in tree order.
+     *
+     * @param idx Index into the function's lvars
+     * @return Occurrences (empty for unknown indexes)
+     */
+    std::span<const lvar_occurrence_t> occurrences(int idx) const
+    {
+        if (idx < 0 || size_t(idx) >= var_count())
+            return {};
+        return std::span<const lvar_occurrence_t>(occs.data() + offsets[idx], offsets[idx + 1] - offsets[idx]);
+    }
+
+    /**
+     * @brief Count the occurrences of a variable matching any of the given kinds.
+     */
+    size_t count(int idx, uint8_t kinds = LVR_ANY) const
+    {
+        size_t n = 0;
+        for (auto& occ : occurrences(idx))
+            n += (occ.kind & kinds) != 0;
+        return n;
+    }
+
+    /**
+     * @brief Get the union of the occurrence kinds of a variable in O(1).
+     *
+     * @return LVR_* flags, or 0 if the variable does not occur
+     */
+    uint8_t kinds_of(int idx) const
+    {
+        return (idx < 0 || size_t(idx) >= var_count()) ? 0 : var_kinds[idx];
+    }
+
+    /// true if the address of the variable is taken anywhere
+    bool is_address_taken(int idx) const { return (kinds_of(idx) & LVR_ADDR) != 0; }
+
+    /// true if the variable never occurs in the ctree
+    bool is_unused(int idx) const { return kinds_of(idx) == 0; }
+
+    /**
+     * @brief Get the distinct statements referencing a variable, in tree order.
+     *
+     * @param idx Variable index
+     * @param out Output statements
+     * @param kinds Only consider occurrences of these kinds
+     * @return Number of statements
+     */
+    size_t stmts_of(int idx, std::vector<cinsn_t*>& out, uint8_t kinds = LVR_ANY) const
+    {
+        out.clear();
+        for (auto& occ : occurrences(idx))
+        {
+            if ((occ.kind & kinds) == 0)
+                continue;
+            // Occurrences of one statement are adjacent in tree order
+            if (out.empty() || out.back() != occ.stmt)
+                out.push_back(occ.stmt);
+        }
+        return out.size();
+    }
+
+    /**
+     * @brief Approximate heap memory used by the index, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return offsets.capacity() * sizeof(uint32_t)
+             + occs.capacity() * sizeof(lvar_occurrence_t)
+             + var_kinds.capacity() * sizeof(uint8_t);
+    }
+};
+
+}  // namespace idacpp::hexrays
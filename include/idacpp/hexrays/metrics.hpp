@@ -0,0 +1,517 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Single-pass function complexity metrics
+*/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <hexrays.hpp>
+#include <funcs.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/batch.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Per-function metric (column index)
+enum func_metric_t : uint8_t
+{
+    FM_NODES,        ///< Ctree items
+    FM_STMTS,        ///< Statements
+    FM_EXPRS,        ///< Expressions
+    FM_CYCLOMATIC,   ///< 1 + decision points (if, loops, extra switch cases, &&, ||, ?:)
+    FM_NESTING,      ///< Deepest nesting of control statements
+    FM_DEPTH,        ///< Deepest ctree item below the body
+    FM_CALLS,        ///< Call expressions
+    FM_LOOPS,        ///< for/while/do statements
+    FM_IFS,          ///< if statements
+    FM_SWITCHES,     ///< switch statements
+    FM_GOTOS,        ///< goto statements
+    FM_RETURNS,      ///< return statements
+    FM_VARS,         ///< Distinct local variables referenced
+    FM_COUNT
+};
+
+/// Set of metrics
+using metric_set_t = std::bitset<FM_COUNT>;
+
+/// Every metric
+inline metric_set_t all_metrics()
+{
+    return metric_set_t().set();
+}
+
+/// Column name of a metric
+inline const char* metric_name(func_metric_t m)
+{
+    static const char* const names[FM_COUNT] =
+    {
+        "nodes", "stmts", "exprs", "cyclomatic", "nesting", "depth", "calls",
+        "loops", "ifs", "switches", "gotos", "returns", "vars",
+    };
+    return m < FM_COUNT ? names[m] : "?";
+}
+
+/// One row of metric values, indexed by func_metric_t
+using metric_row_t = std::array<uint32_t, FM_COUNT>;
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Column-oriented metric results, one row per function.
+ *
+ * Only the selected metrics have a column; the others stay empty.
+ */
+class metrics_table_t
+{
+public:
+    metric_set_t metrics;                                 ///< Metrics with a column
+    std::vector<ea_t> func_ea;                            ///< Function of each row
+    std::array<std::vector<uint32_t>, FM_COUNT> columns;  ///< Values, indexed by metric then row
+
+    /// Number of rows
+    size_t size() const { return func_ea.size(); }
+
+    /**
+     * @brief Append one row.
+     */
+    void add_row(ea_t ea, const metric_row_t& values)
+    {
+        func_ea.push_back(ea);
+        for (size_t m = 0; m < FM_COUNT; ++m)
+            if (metrics.test(m))
+                columns[m].push_back(values[m]);
+    }
+
+    /**
+     * @brief Get one metric column.
+     *
+     * @return Values per row (empty if the metric was not selected)
+     */
+    std::span<const uint32_t> column(func_metric_t m) const
+    {
+        return std::span<const uint32_t>(columns[m]);
+    }
+
+    /// Value of a metric for a row (0 if the metric was not selected)
+    uint32_t get(size_t row, func_metric_t m) const
+    {
+        return metrics.test(m) ? columns[m][row] : 0;
+    }
+
+    /**
+     * @brief Find the row of a function.
+     *
+     * @return Row, or SIZE_MAX if the function has no row
+     */
+    size_t find_row(ea_t ea) const
+    {
+        auto p = std::find(func_ea.begin(), func_ea.end(), ea);
+        return p == func_ea.end() ? SIZE_MAX : size_t(p - func_ea.begin());
+    }
+
+    /**
+     * @brief Remove all rows, keeping the metric selection.
+     */
+    void clear()
+    {
+        func_ea.clear();
+        for (auto& c : columns)
+            c.clear();
+    }
+
+    /**
+     * @brief Approximate heap memory used by the table, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        size_t total = func_ea.capacity() * sizeof(ea_t);
+        for (auto& c : columns)
+            total += c.capacity() * sizeof(uint32_t);
+        return total;
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Receives metric rows as they are computed.
+ */
+class metrics_sink_t
+{
+public:
+    virtual ~metrics_sink_t() = default;
+
+    /// Called once before the first row
+    virtual void on_begin(const metric_set_t& metrics) {}
+
+    /**
+     * @brief Called for each function.
+     *
+     * @return false to stop the run
+     */
+    virtual bool on_row(ea_t func_ea, const metric_row_t& values) = 0;
+
+    /// Called once after the last row
+    virtual void on_end() {}
+};
+
+/**
+ * @brief Base for sinks that write to a file.
+ */
+class metrics_file_sink_t : public metrics_sink_t
+{
+protected:
+    FILE* fp;
+    bool owned;
+    metric_set_t metrics;
+    qstring name;
+
+    /// Fetch the function name into `name`
+    void fetch_name(ea_t ea)
+    {
+        name.qclear();
+        get_func_name(&name, ea);
+    }
+
+public:
+    /**
+     * @brief Write to an already open file (not closed by the sink).
+     */
+    explicit metrics_file_sink_t(FILE* fp) : fp(fp), owned(false) {}
+
+    /**
+     * @brief Create and own an output file.
+     */
+    explicit metrics_file_sink_t(const char* path) : fp(qfopen(path, "w")), owned(true) {}
+
+    ~metrics_file_sink_t() override
+    {
+        if (owned && fp != nullptr)
+            qfclose(fp);
+    }
+
+    metrics_file_sink_t(const metrics_file_sink_t&) = delete;
+    metrics_file_sink_t& operator=(const metrics_file_sink_t&) = delete;
+
+    /// true if the output file is open
+    bool is_open() const { return fp != nullptr; }
+};
+
+/**
+ * @brief Sink that writes CSV: a header line, then one line per function.
+ *
+ * Columns: ea, name, then each selected metric.
+ */
+class metrics_csv_sink_t : public metrics_file_sink_t
+{
+public:
+    using metrics_file_sink_t::metrics_file_sink_t;
+
+    void on_begin(const metric_set_t& m) override
+    {
+        metrics = m;
+        if (fp == nullptr)
+            return;
+        qfprintf(fp, "ea,name");
+        for (size_t i = 0; i < FM_COUNT; ++i)
+            if (metrics.test(i))
+                qfprintf(fp, ",%s", metric_name(func_metric_t(i)));
+        qfprintf(fp, "\n");
+    }
+
+    bool on_row(ea_t func_ea, const metric_row_t& values) override
+    {
+        if (fp == nullptr)
+            return false;
+        fetch_name(func_ea);
+        qfprintf(fp, "0x%llX,\"", (unsigned long long)func_ea);
+        for (const char* p = name.c_str(); *p != '\0'; ++p)
+        {
+            if (*p == '"')
+                qfputc('"', fp);
+            qfputc(*p, fp);
+        }
+        qfputc('"', fp);
+        for (size_t i = 0; i < FM_COUNT; ++i)
+            if (metrics.test(i))
+                qfprintf(fp, ",%u", values[i]);
+        qfprintf(fp, "\n");
+        return true;
+    }
+};
+
+/**
+ * @brief Sink that writes a JSON array with one object per function.
+ *
+ * Objects are written as they arrive; the array is closed by on_end().
+ */
+class metrics_json_sink_t : public metrics_file_sink_t
+{
+private:
+    size_t rows = 0;
+
+    void write_escaped(const char* s)
+    {
+        for (; *s != '\0'; ++s)
+        {
+            auto c = uchar(*s);
+            if (c == '"' || c == '\\')
+                qfprintf(fp, "\\%c", c);
+            else if (c < 0x20)
+                qfprintf(fp, "\\u%04x", c);
+            else
+                qfputc(c, fp);
+        }
+    }
+
+public:
+    using metrics_file_sink_t::metrics_file_sink_t;
+
+    void on_begin(const metric_set_t& m) override
+    {
+        metrics = m;
+        rows = 0;
+        if (fp != nullptr)
+            qfprintf(fp, "[");
+    }
+
+    bool on_row(ea_t func_ea, const metric_row_t& values) override
+    {
+        if (fp == nullptr)
+            return false;
+        fetch_name(func_ea);
+        qfprintf(fp, "%s\n  {\"ea\": %llu, \"name\": \"", rows++ == 0 ? "" : ",", (unsigned long long)func_ea);
+        write_escaped(name.c_str());
+        qfprintf(fp, "\"");
+        for (size_t i = 0; i < FM_COUNT; ++i)
+            if (metrics.test(i))
+                qfprintf(fp, ", \"%s\": %u", metric_name(func_metric_t(i)), values[i]);
+        qfprintf(fp, "}");
+        return true;
+    }
+
+    void on_end() override
+    {
+        if (fp != nullptr)
+            qfprintf(fp, "\n]\n");
+    }
+};
+
+/**
+ * @brief Stream the rows of a table to a sink (e.g. to export stored results).
+ *
+ * @return false if the sink stopped early
+ */
+inline bool export_metrics(const metrics_table_t& table, metrics_sink_t& sink)
+{
+    sink.on_begin(table.metrics);
+    metric_row_t row;
+    bool ok = true;
+    for (size_t r = 0; r < table.size() && ok; ++r)
+    {
+        for (size_t m = 0; m < FM_COUNT; ++m)
+            row[m] = table.get(r, func_metric_t(m));
+        ok = sink.on_row(table.func_ea[r], row);
+    }
+    sink.on_end();
+    return ok;
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Computes a set of metrics for many functions in one pass each.
+ *
+ * Each function is reduced to its snapshot (cached snapshots are used as is)
+ * and all selected metrics are accumulated in a single sweep over its columns,
+ * with no visitor and no per-metric traversal. Results go to a columnar
+ * table, a streaming sink, or both.
+ *
+ * @example
+ * @code
+ * metric_set_t m;
+ * m.set(FM_CYCLOMATIC).set(FM_NESTING).set(FM_CALLS);
+ * metrics_engine_t engine(m);
+ * metrics_csv_sink_t csv("metrics.csv");
+ * batch_query_t q;
+ * engine.run(q, nullptr, &csv);
+ * @endcode
+ */
+class metrics_engine_t
+{
+private:
+    metric_set_t metrics;
+
+    // Scratch reused across functions
+    std::vector<uint32_t> depth;
+    std::vector<uint32_t> nest;
+    std::vector<uint8_t> var_seen;
+
+    static bool is_control(ctype_t op)
+    {
+        return op == cit_if || op == cit_for || op == cit_while || op == cit_do || op == cit_switch;
+    }
+
+public:
+    /**
+     * @param metrics Metrics to compute
+     */
+    explicit metrics_engine_t(const metric_set_t& metrics = all_metrics()) : metrics(metrics) {}
+
+    /// Selected metrics
+    const metric_set_t& get_metrics() const { return metrics; }
+
+    /**
+     * @brief Compute the selected metrics of one function.
+     *
+     * @param snap Function snapshot
+     * @param out Output values (unselected metrics are 0)
+     */
+    void compute(const ctree_snapshot_t& snap, metric_row_t& out)
+    {
+        out.fill(0);
+        size_t n = snap.size();
+        if (n == 0)
+            return;
+
+        bool want_depth = metrics.test(FM_DEPTH);
+        bool want_nest = metrics.test(FM_NESTING);
+        bool want_vars = metrics.test(FM_VARS);
+        if (want_depth)
+            depth.resize(n);
+        if (want_nest)
+            nest.resize(n);
+
+        uint32_t decisions = 0;
+        uint32_t max_depth = 0;
+        uint32_t max_nest = 0;
+        uint32_t vars = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto op = snap.op_of(node_id_t(i));
+            node_id_t par = snap.parent[i];
+
+            if (want_depth)
+            {
+                depth[i] = par == BAD_NODE_ID ? 0 : depth[par] + 1;
+                max_depth = std::max<uint32_t>(max_depth, depth[i]);
+            }
+            if (want_nest)
+            {
+                nest[i] = par == BAD_NODE_ID ? 0 : nest[par] + (is_control(snap.op_of(par)) ? 1 : 0);
+                if (is_control(op))
+                    max_nest = std::max<uint32_t>(max_nest, nest[i] + 1);
+            }
+
+            if (op >= cit_empty)
+            {
+                ++out[FM_STMTS];
+                switch (op)
+                {
+                    case cit_if:     ++out[FM_IFS]; ++decisions; break;
+                    case cit_for:
+                    case cit_while:
+                    case cit_do:     ++out[FM_LOOPS]; ++decisions; break;
+                    case cit_goto:   ++out[FM_GOTOS]; break;
+                    case cit_return: ++out[FM_RETURNS]; break;
+                    case cit_switch:
+                    {
+                        ++out[FM_SWITCHES];
+                        // Children are the switch expression, then one node per case
+                        uint32_t cases = 0;
+                        for (node_id_t c = snap.first_child(node_id_t(i)); c != BAD_NODE_ID; c = snap.next_sibling(c))
+                            ++cases;
+                        decisions += cases > 2 ? cases - 2 : 0;
+                        break;
+                    }
+                    default: break;
+                }
+            }
+            else
+            {
+                ++out[FM_EXPRS];
+                switch (op)
+                {
+                    case cot_call: ++out[FM_CALLS]; break;
+                    case cot_land:
+                    case cot_lor:
+                    case cot_tern: ++decisions; break;
+                    case cot_var:
+                        if (want_vars)
+                        {
+                            uint64_t idx = snap.aux[i];
+                            if (idx >= var_seen.size())
+                                var_seen.resize(size_t(idx) + 1, 0);
+                            if (var_seen[idx] == 0)
+                            {
+                                var_seen[idx] = 1;
+                                ++vars;
+                            }
+                        }
+                        break;
+                    default: break;
+                }
+            }
+        }
+
+        if (want_vars)
+            std::fill(var_seen.begin(), var_seen.end(), 0);
+
+        out[FM_NODES] = uint32_t(n);
+        out[FM_CYCLOMATIC] = 1 + decisions;
+        out[FM_NESTING] = max_nest;
+        out[FM_DEPTH] = max_depth;
+        out[FM_VARS] = vars;
+        for (size_t m = 0; m < FM_COUNT; ++m)
+            if (!metrics.test(m))
+                out[m] = 0;
+    }
+
+    /**
+     * @brief Compute the metrics of every function selected by a batch query.
+     *
+     * Every function is processed (q.ops is ignored for the run).
+     *
+     * @param q Batch query (order, function list, flags and cache)
+     * @param table Optional output table (its metric selection is reset)
+     * @param sink Optional streaming sink; returning false from on_row() stops the run
+     * @return Run statistics
+     */
+    batch_stats_t run(batch_query_t& q, metrics_table_t* table, metrics_sink_t* sink = nullptr)
+    {
+        if (table != nullptr)
+        {
+            table->metrics = metrics;
+            table->clear();
+        }
+        if (sink != nullptr)
+            sink->on_begin(metrics);
+
+        metric_row_t row;
+        ctype_set_t saved_ops = q.ops;
+        q.ops.reset();
+        auto st = q.for_each_snapshot([&](const ctree_snapshot_t& snap, batch_stats_t&)
+        {
+            compute(snap, row);
+            if (table != nullptr)
+                table->add_row(snap.func_ea, row);
+            return sink == nullptr || sink->on_row(snap.func_ea, row);
+        });
+        q.ops = saved_ops;
+
+        if (sink != nullptr)
+            sink->on_end();
+        return st;
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,366 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Microcode (mba_t) parent and def-use index
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Kind of location tracked by the microcode def/use lists
+enum mloc_kind_t : uint8_t
+{
+    MLOC_REG,    ///< Micro register (mop_r), keyed by mreg_t
+    MLOC_STK,    ///< Stack variable (mop_S), keyed by stack offset
+    MLOC_LVAR,   ///< Local variable (mop_l), keyed by lvar index
+};
+
+/**
+ * @brief One definition or use of a tracked location.
+ */
+struct mop_ref_t
+{
+    mloc_kind_t kind;    ///< Location kind
+    bool is_def;         ///< true for a definition, false for a use
+    int64_t key;         ///< Register number, stack offset or lvar index
+    uint32_t insn;       ///< Index of the referencing instruction (see mba_index_t::insn_at)
+    mop_t* mop;          ///< The operand itself
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Parent, block, EA and def-use index over a microcode array.
+ *
+ * Built in one mba_t::for_all_insns() pass into flat vectors. Records:
+ * - the parent instruction of every operand (including call arguments and
+ *   address/pair sub-operands; sub-instructions are indexed as instructions)
+ * - the block and top-level instruction of every instruction
+ * - definition and use lists for registers, stack variables and lvars
+ * - the instructions at each address
+ *
+ * Intended for optinsn_t/optblock_t callbacks, which fire many times per
+ * decompilation: invalidate() is O(1) and the next ensure() rebuilds into the
+ * already allocated storage. Only the destination operand of an instruction
+ * that modifies it counts as a definition; side effects of calls are not
+ * modeled.
+ *
+ * ensure() is O(1) when the index is current: it rebuilds only after
+ * invalidate() or when the mba_t pointer, maturity or block count differ
+ * from the indexed ones. Any other change to the microcode (by this
+ * optimizer, by Hex-Rays passes or by other plugins) goes unnoticed, so call
+ * invalidate() whenever the microcode may have changed since the last
+ * ensure(), e.g. after returning a nonzero change count. verify() compares
+ * a fingerprint of every top-level instruction (address and opcode) in
+ * O(n) and can be used to check that discipline in debug builds; it does
+ * not see operands rewritten in place either.
+ *
+ * @example
+ * @code
+ * struct my_opt_t : public optinsn_t
+ * {
+ *     mba_index_t index;
+ *     int idaapi func(mblock_t* blk, minsn_t* ins, int) override
+ *     {
+ *         index.ensure(blk->mba);        // O(1) unless stale
+ *         QASSERT(100000, index.verify());  // debug builds only
+ *         for (auto& ref : index.uses(MLOC_REG, ins->d.r)) { ... }
+ *         int changes = ...;
+ *         if (changes != 0)
+ *             index.invalidate();
+ *         return changes;
+ *     }
+ * };
+ * @endcode
+ */
+class mba_index_t
+{
+private:
+    /// Fingerprint of the top-level instructions (see verify())
+    struct mba_print_t
+    {
+        size_t ninsns = 0;
+        uint64_t mix = 0;
+
+        bool operator==(const mba_print_t&) const = default;
+    };
+
+    mba_t* mba = nullptr;
+    bool valid = false;
+    uint32_t generation = 0;
+    mba_maturity_t maturity = MMAT_ZERO;
+    int qty = 0;
+    mba_print_t print;
+
+    std::vector<minsn_t*> insns;                       ///< Every instruction, in for_all_insns order
+    std::vector<int> insn_block;                       ///< Block serial, parallel to insns
+    std::vector<minsn_t*> insn_top;                    ///< Top-level instruction, parallel to insns
+    std::vector<std::pair<const minsn_t*, uint32_t>> insn_ids;  ///< Sorted by instruction
+    std::vector<std::pair<const mop_t*, uint32_t>> mop_parent;  ///< Sorted by operand
+    std::vector<mop_ref_t> refs;                       ///< Sorted by (kind, key, is_def, insn)
+    std::vector<std::pair<ea_t, minsn_t*>> ea_insns;   ///< Sorted by address
+
+    static bool ref_less(const mop_ref_t& a, const mop_ref_t& b)
+    {
+        if (a.kind != b.kind)
+            return a.kind < b.kind;
+        if (a.key != b.key)
+            return a.key < b.key;
+        if (a.is_def != b.is_def)
+            return a.is_def < b.is_def;
+        return a.insn < b.insn;
+    }
+
+    void add_mop(mop_t* mop, uint32_t insn_id, bool is_def)
+    {
+        mop_parent.emplace_back(mop, insn_id);
+        switch (mop->t)
+        {
+            case mop_r:
+                refs.push_back(mop_ref_t{MLOC_REG, is_def, int64_t(mop->r), insn_id, mop});
+                break;
+            case mop_S:
+                refs.push_back(mop_ref_t{MLOC_STK, is_def, int64_t(mop->s->off), insn_id, mop});
+                break;
+            case mop_l:
+                refs.push_back(mop_ref_t{MLOC_LVAR, is_def, int64_t(mop->l->idx), insn_id, mop});
+                break;
+            case mop_f:
+                for (auto& arg : mop->f->args)
+                    add_mop(&arg, insn_id, false);
+                break;
+            case mop_a:
+                add_mop(mop->a, insn_id, false);
+                break;
+            case mop_p:
+                add_mop(&mop->pair->lop, insn_id, is_def);
+                add_mop(&mop->pair->hop, insn_id, is_def);
+                break;
+            default:
+                // mop_d sub-instructions are visited by for_all_insns on their own
+                break;
+        }
+    }
+
+    void build()
+    {
+        insns.clear();
+        insn_block.clear();
+        insn_top.clear();
+        insn_ids.clear();
+        mop_parent.clear();
+        refs.clear();
+        ea_insns.clear();
+
+        struct collector_t : public minsn_visitor_t
+        {
+            mba_index_t* self;
+            explicit collector_t(mba_index_t* self) : self(self) {}
+
+            int idaapi visit_minsn() override
+            {
+                auto id = uint32_t(self->insns.size());
+                self->insns.push_back(curins);
+                self->insn_block.push_back(blk->serial);
+                self->insn_top.push_back(topins);
+                self->insn_ids.emplace_back(curins, id);
+
+                self->ea_insns.emplace_back(curins->ea, curins);
+                self->add_mop(&curins->l, id, false);
+                self->add_mop(&curins->r, id, false);
+                self->add_mop(&curins->d, id, curins->modifies_d());
+                return 0;
+            }
+        };
+
+        collector_t collector(this);
+        mba->for_all_insns(collector);
+
+        auto by_key = [](auto& a, auto& b) { return a.first < b.first; };
+        std::sort(insn_ids.begin(), insn_ids.end(), by_key);
+        std::sort(mop_parent.begin(), mop_parent.end(), by_key);
+        std::sort(refs.begin(), refs.end(), ref_less);
+        std::stable_sort(ea_insns.begin(), ea_insns.end(), [](auto& a, auto& b) { return a.first < b.first; });
+        maturity = mba->maturity;
+        qty = mba->qty;
+        print = fingerprint(mba);
+        valid = true;
+        ++generation;
+    }
+
+    static mba_print_t fingerprint(const mba_t* m)
+    {
+        mba_print_t st;
+        for (int i = 0; i < m->qty; ++i)
+        {
+            for (const minsn_t* ins = m->get_mblock(i)->head; ins != nullptr; ins = ins->next)
+            {
+                ++st.ninsns;
+                st.mix = (st.mix ^ (uint64_t(uintptr_t(ins)) + uint64_t(ins->opcode))) * 0x100000001B3ULL;
+            }
+        }
+        return st;
+    }
+
+    template <typename T>
+    static uint32_t find_id(const std::vector<std::pair<const T*, uint32_t>>& v, const T* key)
+    {
+        auto p = std::lower_bound(v.begin(), v.end(), key, [](auto& e, const T* k) { return e.first < k; });
+        return p != v.end() && p->first == key ? p->second : UINT32_MAX;
+    }
+
+    std::span<const mop_ref_t> find_refs(mloc_kind_t kind, int64_t key, bool is_def) const
+    {
+        mop_ref_t lo{kind, is_def, key, 0, nullptr};
+        mop_ref_t hi{kind, is_def, key, UINT32_MAX, nullptr};
+        auto first = std::lower_bound(refs.begin(), refs.end(), lo, ref_less);
+        auto last = std::upper_bound(first, refs.end(), hi, ref_less);
+        return std::span<const mop_ref_t>(refs.data() + (first - refs.begin()), size_t(last - first));
+    }
+
+public:
+    /**
+     * @brief Make sure the index describes a microcode array, rebuilding it if needed.
+     *
+     * O(1) when the index is valid for the same mba_t, maturity and block
+     * count; other changes must be reported with invalidate().
+     *
+     * @param m Microcode array
+     * @return true if the index was rebuilt
+     */
+    bool ensure(mba_t* m)
+    {
+        if (valid && m == mba && m->maturity == maturity && m->qty == qty)
+            return false;
+        mba = m;
+        build();
+        return true;
+    }
+
+    /**
+     * @brief Check the index against the current microcode (O(n), for debugging).
+     *
+     * Compares the fingerprint of the top-level instructions taken at build
+     * time with the current one. A mismatch invalidates the index.
+     *
+     * @return true if the index is valid and no instruction was added, removed or replaced
+     */
+    bool verify()
+    {
+        if (!valid)
+            return false;
+        if (mba->maturity != maturity || mba->qty != qty || !(fingerprint(mba) == print))
+            valid = false;
+        return valid;
+    }
+
+    /**
+     * @brief Mark the index stale in O(1). Storage is kept for the next rebuild.
+     */
+    void invalidate()
+    {
+        valid = false;
+    }
+
+    /// true if the index is up to date
+    bool is_valid() const { return valid; }
+
+    /// Incremented on every rebuild; lets callers detect stale derived data
+    uint32_t get_generation() const { return generation; }
+
+    /// Indexed microcode array
+    mba_t* get_mba() const { return mba; }
+
+    /// Number of indexed instructions (including sub-instructions)
+    size_t insn_count() const { return insns.size(); }
+
+    /// Instruction by index
+    minsn_t* insn_at(uint32_t id) const { return insns[id]; }
+
+    /**
+     * @brief Get the index of an instruction.
+     *
+     * @return Instruction index, or UINT32_MAX if not indexed
+     */
+    uint32_t insn_id(const minsn_t* ins) const
+    {
+        return find_id(insn_ids, ins);
+    }
+
+    /**
+     * @brief Get the instruction that owns an operand.
+     *
+     * @return Parent instruction, or nullptr if the operand is not indexed
+     */
+    minsn_t* parent_of(const mop_t* mop) const
+    {
+        auto id = find_id(mop_parent, mop);
+        return id == UINT32_MAX ? nullptr : insns[id];
+    }
+
+    /**
+     * @brief Get the block containing an instruction.
+     *
+     * @return Block, or nullptr if the instruction is not indexed
+     */
+    mblock_t* block_of(const minsn_t* ins) const
+    {
+        auto id = insn_id(ins);
+        return id == UINT32_MAX ? nullptr : mba->get_mblock(insn_block[id]);
+    }
+
+    /**
+     * @brief Get the top-level instruction containing a (sub-)instruction.
+     *
+     * @return Top-level instruction, or nullptr if the instruction is not indexed
+     */
+    minsn_t* top_of(const minsn_t* ins) const
+    {
+        auto id = insn_id(ins);
+        return id == UINT32_MAX ? nullptr : insn_top[id];
+    }
+
+    /**
+     * @brief Get every definition of a location, in instruction order.
+     */
+    std::span<const mop_ref_t> defs(mloc_kind_t kind, int64_t key) const
+    {
+        return find_refs(kind, key, true);
+    }
+
+    /**
+     * @brief Get every use of a location, in instruction order.
+     */
+    std::span<const mop_ref_t> uses(mloc_kind_t kind, int64_t key) const
+    {
+        return find_refs(kind, key, false);
+    }
+
+    /**
+     * @brief Get the instructions (including sub-instructions) at an address.
+     *
+     * @param ea Address
+     * @param out Output instructions, in for_all_insns order
+     * @return Number of instructions found
+     */
+    size_t insns_at(ea_t ea, std::vector<minsn_t*>& out) const
+    {
+        out.clear();
+        auto first = std::lower_bound(ea_insns.begin(), ea_insns.end(), ea,
+                                      [](auto& p, ea_t v) { return p.first < v; });
+        for (; first != ea_insns.end() && first->first == ea; ++first)
+            out.push_back(first->second);
+        return out.size();
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,250 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Fused multi-visitor ctree traversal
+*/
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/core/core.hpp>
+#include <idacpp/hexrays/hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Runs several ctree visitors in a single traversal.
+ *
+ * Each registered visitor keeps its own semantics:
+ * - an op filter: it is only called for item types in its set
+ * - early termination: a non-zero return stops that visitor only
+ * - pruning: prune_now() skips the current subtree for that visitor only
+ * - CV_POST: leave_insn()/leave_expr() are called for it
+ * - CV_PARENTS: its `parents` stack is valid during its callbacks
+ * - CV_INSNS: it never sees expressions
+ *
+ * The shared traversal is pruned once every live visitor pruned the current
+ * subtree, stops once every visitor terminated, and skips expressions entirely
+ * when no visitor wants any cot_* type.
+ *
+ * @example
+ * @code
+ * ctree_multiplexer_t mux;
+ * my_calls_visitor_t calls;       // any existing ctree_visitor_t
+ * ctype_set_t only_calls;
+ * only_calls.set(cot_call);
+ * mux.add(&calls, only_calls);
+ * mux.add([](citem_t* item) { ...; return 0; });
+ * mux.run(cfunc);
+ * @endcode
+ */
+class ctree_multiplexer_t : public ctree_visitor_t
+{
+private:
+    struct slot_t
+    {
+        ctree_visitor_t* v;
+        ctype_set_t ops;
+        const citem_t* pruned_at = nullptr;  ///< Root of the subtree this visitor pruned
+        int code = 0;                        ///< Non-zero once the visitor terminated
+    };
+
+    /// Adapter for callback-based registrations
+    struct callback_visitor_t : public ctree_visitor_t
+    {
+        std::function<int(citem_t*)> cb;
+
+        explicit callback_visitor_t(std::function<int(citem_t*)> cb)
+            : ctree_visitor_t(CV_FAST), cb(std::move(cb)) {}
+
+        int idaapi visit_insn(cinsn_t* ins) override { return cb(ins); }
+        int idaapi visit_expr(cexpr_t* e) override { return cb(e); }
+    };
+
+    std::vector<slot_t> slots;
+    core::objcontainer_t<callback_visitor_t> owned;
+    size_t live = 0;       ///< Visitors that have not terminated
+    size_t unpruned = 0;   ///< Live visitors not inside a pruned subtree
+
+    bool wants(const slot_t& s, const citem_t* item) const
+    {
+        return s.code == 0
+            && s.pruned_at == nullptr
+            && s.ops.test(item->op)
+            && !(item->is_expr() && s.v->only_insns());
+    }
+
+    int call(slot_t& s, citem_t* item, bool leave)
+    {
+        // Lend our parent stack to the visitor for the duration of the call
+        bool lend = s.v->maintain_parents();
+        if (lend)
+            s.v->parents.swap(parents);
+
+        int code;
+        if (item->is_expr())
+            code = leave ? s.v->leave_expr((cexpr_t*)item) : s.v->visit_expr((cexpr_t*)item);
+        else
+            code = leave ? s.v->leave_insn((cinsn_t*)item) : s.v->visit_insn((cinsn_t*)item);
+
+        if (lend)
+            s.v->parents.swap(parents);
+        return code;
+    }
+
+    int visit(citem_t* item)
+    {
+        const citem_t* pruned_here = nullptr;
+        for (auto& s : slots)
+        {
+            if (!wants(s, item))
+                continue;
+
+            s.code = call(s, item, false);
+            if (s.code != 0)
+            {
+                --live;
+                --unpruned;
+            }
+            else if (s.v->must_prune())
+            {
+                s.v->clr_prune();
+                s.pruned_at = item;
+                pruned_here = item;
+                --unpruned;
+            }
+        }
+
+        if (live == 0)
+            return 1;
+
+        if (unpruned == 0 && pruned_here != nullptr)
+        {
+            // Nobody wants this subtree: skip it for everyone
+            for (auto& s : slots)
+            {
+                if (s.pruned_at == pruned_here)
+                {
+                    s.pruned_at = nullptr;
+                    ++unpruned;
+                }
+            }
+            prune_now();
+        }
+        return 0;
+    }
+
+    int leave(citem_t* item)
+    {
+        for (auto& s : slots)
+        {
+            if (s.pruned_at == item)
+            {
+                s.pruned_at = nullptr;
+                ++unpruned;
+                continue;
+            }
+            if (s.v->is_postorder() && wants(s, item))
+            {
+                s.code = call(s, item, true);
+                if (s.code != 0)
+                {
+                    --live;
+                    --unpruned;
+                }
+            }
+        }
+        return live == 0 ? 1 : 0;
+    }
+
+public:
+    ctree_multiplexer_t() : ctree_visitor_t(CV_PARENTS | CV_POST) {}
+
+    /**
+     * @brief Register a visitor.
+     *
+     * @param v Visitor (not owned; must outlive the traversal)
+     * @param ops Item types the visitor wants (empty means all)
+     */
+    void add(ctree_visitor_t* v, const ctype_set_t& ops = ctype_set_t())
+    {
+        slots.push_back(slot_t{v, ops.none() ? ctype_set_t().set() : ops});
+    }
+
+    /**
+     * @brief Register a callback invoked for every wanted item.
+     *
+     * @param cb Callback; return non-zero to stop this callback only
+     * @param ops Item types the callback wants (empty means all)
+     * @return The adapter visitor (owned by the multiplexer), e.g. to call prune_now()
+     */
+    ctree_visitor_t* add(std::function<int(citem_t*)> cb, const ctype_set_t& ops = ctype_set_t())
+    {
+        auto v = owned.create(std::move(cb));
+        add(v, ops);
+        return v;
+    }
+
+    /**
+     * @brief Get the termination code of the n-th registered visitor.
+     *
+     * @return Non-zero if the visitor stopped early
+     */
+    int result_of(size_t n) const { return slots[n].code; }
+
+    /// Number of registered visitors
+    size_t size() const { return slots.size(); }
+
+    /**
+     * @brief Traverse a subtree once, dispatching to every registered visitor.
+     *
+     * @param root Root item
+     * @param parent Parent of the root item (optional)
+     * @return 0 if the traversal completed, 1 if every visitor terminated early
+     */
+    int run(citem_t* root, citem_t* parent = nullptr)
+    {
+        ctype_set_t all_ops;
+        bool all_insns = true;
+        for (auto& s : slots)
+        {
+            s.pruned_at = nullptr;
+            s.code = 0;
+            all_ops |= s.ops;
+            all_insns = all_insns && s.v->only_insns();
+        }
+        live = unpruned = slots.size();
+        if (live == 0)
+            return 0;
+
+        // Skip expressions entirely when nobody asked for them
+        bool any_expr = false;
+        for (int op = cot_empty; op <= cot_last && !any_expr; ++op)
+            any_expr = all_ops.test(op);
+
+        cv_flags = CV_PARENTS | CV_POST | ((all_insns || !any_expr) ? CV_INSNS : 0);
+        parents.clear();
+        return apply_to(root, parent);
+    }
+
+    /**
+     * @brief Traverse a function body once.
+     */
+    int run(cfunc_t* cfunc)
+    {
+        return run(&cfunc->body, nullptr);
+    }
+
+    int idaapi visit_insn(cinsn_t* ins) override { return visit(ins); }
+    int idaapi visit_expr(cexpr_t* e) override { return visit(e); }
+    int idaapi leave_insn(cinsn_t* ins) override { return leave(ins); }
+    int idaapi leave_expr(cexpr_t* e) override { return leave(e); }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,474 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Idle-time decompilation prefetcher
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <hexrays.hpp>
+#include <kernwin.hpp>
+#include <funcs.hpp>
+#include <xref.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/batch.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+// Prefetch prediction sources:
+#define PFS_CALLEES   0x01  ///< Functions called by the current function
+#define PFS_XREFS     0x02  ///< Functions referenced from the current address
+#define PFS_CALLERS   0x04  ///< Functions calling the current function
+#define PFS_HISTORY   0x08  ///< Previously visited functions (navigation history)
+#define PFS_ALL       0x0F  ///< Every source
+
+/**
+ * @brief Prefetcher counters.
+ */
+struct prefetch_stats_t
+{
+    size_t predicted = 0;    ///< Candidates queued
+    size_t prefetched = 0;   ///< Functions decompiled ahead of time
+    size_t failed = 0;       ///< Prefetch decompilations that failed
+    size_t skipped = 0;      ///< Candidates already cached, failed or too large
+    size_t slices = 0;       ///< Timer slices that did work
+    size_t backoffs = 0;     ///< Timer ticks skipped because of recent user input
+    size_t hits = 0;         ///< Navigations to a function the prefetcher warmed
+    size_t misses = 0;       ///< Navigations to a function that was not cached
+
+    /// Fraction of counted navigations that hit a prefetched function
+    double hit_rate() const
+    {
+        size_t n = hits + misses;
+        return n == 0 ? 0.0 : double(hits) / double(n);
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Speculatively decompiles the functions the user is likely to visit next.
+ *
+ * A kernel timer drives the work. Each tick runs only if no user input was
+ * seen for `idle_ms`; it then decompiles queued candidates until `slice_ms` is
+ * spent, storing the cfunc and a snapshot in a cfunc_cache_t, whose change
+ * tracking start() turns on so edited functions are dropped. Prefetched
+ * snapshots share the cache's snapshot LRU, and warmed functions are
+ * forgotten once their snapshot leaves it. Decompilation
+ * also fills the decompiler's own cache, so a later F5 on a prefetched
+ * function is immediate.
+ *
+ * Candidates are re-predicted whenever the user enters another function:
+ * references from the current address first, then callees in call order,
+ * history neighbors and callers. Input is detected through UI notifications
+ * (cursor moves, actions) and decompiler view events, which are delivered
+ * between timer ticks: a slice runs to its `slice_ms` budget and the next
+ * tick backs off. A single decompilation cannot be interrupted, so functions
+ * larger than `max_func_size` are never prefetched.
+ *
+ * @example
+ * @code
+ * struct plugin_ctx_t : public plugmod_t
+ * {
+ *     cfunc_cache_t cache;
+ *     decompile_prefetcher_t prefetcher{&cache};
+ *     plugin_ctx_t() { prefetcher.start(); }
+ *     ~plugin_ctx_t() override { prefetcher.stop(); }
+ * };
+ * @endcode
+ */
+class decompile_prefetcher_t : public event_listener_t
+{
+private:
+    using clock_t_ = std::chrono::steady_clock;
+
+    struct candidate_t
+    {
+        ea_t ea;
+        int score;
+    };
+
+    cfunc_cache_t own_cache;
+    cfunc_cache_t* cache;
+    qtimer_t timer = nullptr;
+    bool hooked = false;
+
+    clock_t_::time_point last_input = clock_t_::now();
+    ea_t cur_func = BADADDR;
+    std::vector<candidate_t> queue;          ///< Sorted by descending score once finished
+    size_t next = 0;                         ///< First candidate not yet consumed
+    std::unordered_map<ea_t, size_t> queued; ///< Pending candidate to its queue position
+    std::deque<ea_t> history;                ///< Visited functions, most recent last
+    std::unordered_set<ea_t> warmed;         ///< Prefetched and not yet visited
+    bool watching = false;                   ///< start() turned on the cache's change tracking
+    prefetch_stats_t st;
+
+    static int idaapi timer_cb(void* ud)
+    {
+        return ((decompile_prefetcher_t*)ud)->tick();
+    }
+
+    static ssize_t idaapi hexrays_cb(void* ud, hexrays_event_t event, va_list va)
+    {
+        switch (event)
+        {
+            case hxe_keyboard:
+            case hxe_right_click:
+            case hxe_double_click:
+            case hxe_curpos:
+            case hxe_switch_pseudocode:
+                ((decompile_prefetcher_t*)ud)->notify_input();
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    static ea_t func_entry(ea_t ea)
+    {
+        func_t* pfn = get_func(ea);
+        return pfn == nullptr ? BADADDR : pfn->start_ea;
+    }
+
+    void enqueue(ea_t ea, int score)
+    {
+        if (ea == BADADDR || ea == cur_func)
+            return;
+        auto p = queued.find(ea);
+        if (p != queued.end())
+        {
+            auto& c = queue[p->second];
+            c.score = std::max(c.score, score);
+            return;
+        }
+        if (queued.size() >= max_candidates)
+            return;
+        queued.emplace(ea, queue.size());
+        queue.push_back(candidate_t{ea, score});
+        ++st.predicted;
+    }
+
+    void clear_queue()
+    {
+        queue.clear();
+        queued.clear();
+        next = 0;
+    }
+
+    void finish_queue()
+    {
+        queue.erase(queue.begin(), queue.begin() + next);
+        next = 0;
+        std::stable_sort(queue.begin(), queue.end(), [](auto& a, auto& b) { return a.score > b.score; });
+        if (queue.size() > max_queue)
+            queue.resize(max_queue);
+        queued.clear();
+        for (size_t i = 0; i < queue.size(); ++i)
+            queued.emplace(queue[i].ea, i);
+    }
+
+    void predict_callees(func_t* pfn)
+    {
+        // Prefer the cached snapshot: it lists the calls in source order
+        int score = 300;
+        auto snap = cache->get_snapshot(pfn->start_ea);
+        if (snap != nullptr)
+        {
+            for (node_id_t i = 0; i + 1 < snap->size(); ++i)
+            {
+                if (snap->op[i] == cot_call && snap->op[i + 1] == cot_obj)
+                    enqueue(func_entry(ea_t(snap->aux[i + 1])), std::max(score--, 200));
+            }
+            return;
+        }
+
+        func_item_iterator_t fii;
+        for (bool ok = fii.set(pfn); ok; ok = fii.next_code())
+        {
+            xrefblk_t xb;
+            for (bool x = xb.first_from(fii.current(), XREF_FAR); x; x = xb.next_from())
+            {
+                if (xb.iscode && (xb.type == fl_CN || xb.type == fl_CF))
+                    enqueue(func_entry(xb.to), std::max(score--, 200));
+            }
+        }
+    }
+
+    void predict_callers(ea_t entry)
+    {
+        xrefblk_t xb;
+        for (bool x = xb.first_to(entry, XREF_FAR); x; x = xb.next_to())
+        {
+            if (xb.iscode && (xb.type == fl_CN || xb.type == fl_CF))
+                enqueue(func_entry(xb.from), 100);
+        }
+    }
+
+    void predict_history()
+    {
+        // Most recently left functions are the likeliest "go back" targets
+        int score = 250;
+        for (auto p = history.rbegin(); p != history.rend() && score > 200; ++p, score -= 10)
+            enqueue(*p, score);
+    }
+
+    void predict_xrefs(ea_t ea)
+    {
+        xrefblk_t xb;
+        for (bool x = xb.first_from(ea, XREF_FAR); x; x = xb.next_from())
+            enqueue(func_entry(xb.to), 400);
+    }
+
+    /// Forget warmed functions whose snapshot left the cache; bounds `warmed` by the snapshot capacity
+    void trim_warmed()
+    {
+        if (warmed.size() <= cache->snapshot_capacity())
+            return;
+        for (auto p = warmed.begin(); p != warmed.end();)
+            p = cache->has_snapshot(*p) ? std::next(p) : warmed.erase(p);
+    }
+
+    bool is_idle() const
+    {
+        return clock_t_::now() - last_input >= std::chrono::milliseconds(idle_ms);
+    }
+
+    int tick()
+    {
+        if (pending() == 0)
+            return int(idle_ms);
+        if (!is_idle())
+        {
+            ++st.backoffs;
+            return int(idle_ms);
+        }
+        run_slice();
+        return int(interval_ms);
+    }
+
+public:
+    uint32_t idle_ms = 400;          ///< Required quiet time before prefetching
+    uint32_t slice_ms = 50;          ///< Time budget of one slice
+    uint32_t interval_ms = 100;      ///< Delay between slices while work is pending
+    size_t max_queue = 32;           ///< Maximum number of queued candidates
+    size_t max_candidates = 256;     ///< Candidates collected per navigation before ranking
+    asize_t max_func_size = 0x4000;  ///< Larger functions are not prefetched
+    uint32_t sources = PFS_ALL;      ///< PFS_* prediction sources
+    size_t max_history = 16;         ///< Navigation history length
+    int decomp_flags = DECOMP_NO_WAIT | DECOMP_NO_HIDE;  ///< Flags passed to decompile_func()
+
+    /**
+     * @param cache Cache to warm (a private one is used if nullptr)
+     */
+    explicit decompile_prefetcher_t(cfunc_cache_t* cache = nullptr)
+        : cache(cache != nullptr ? cache : &own_cache) {}
+
+    ~decompile_prefetcher_t() override
+    {
+        stop();
+    }
+
+    decompile_prefetcher_t(const decompile_prefetcher_t&) = delete;
+    decompile_prefetcher_t& operator=(const decompile_prefetcher_t&) = delete;
+
+    /**
+     * @brief Install the timer and the input/navigation hooks.
+     *
+     * @return true on success
+     */
+    bool start()
+    {
+        if (timer != nullptr)
+            return true;
+        hooked = hook_event_listener(HT_UI, this);
+        install_hexrays_callback(hexrays_cb, this);
+        // Prefetched results must not outlive edits of their function
+        if (!cache->is_watching())
+            watching = cache->watch_changes();
+        timer = register_timer(int(idle_ms), timer_cb, this);
+        return timer != nullptr;
+    }
+
+    /**
+     * @brief Remove the timer and hooks. Cached results are kept.
+     */
+    void stop()
+    {
+        if (timer != nullptr)
+        {
+            unregister_timer(timer);
+            timer = nullptr;
+        }
+        if (hooked)
+        {
+            unhook_event_listener(HT_UI, this);
+            hooked = false;
+        }
+        remove_hexrays_callback(hexrays_cb, this);
+        if (watching)
+        {
+            cache->unwatch_changes();
+            watching = false;
+        }
+    }
+
+    /// true while the timer is installed
+    bool is_running() const { return timer != nullptr; }
+
+    /**
+     * @brief Record user input; the prefetcher backs off for `idle_ms`.
+     */
+    void notify_input()
+    {
+        last_input = clock_t_::now();
+    }
+
+    /**
+     * @brief Record a navigation, update hit/miss counters and re-predict.
+     *
+     * Called automatically on ui_screen_ea_changed once started.
+     *
+     * @param ea New current address
+     */
+    void on_navigate(ea_t ea)
+    {
+        notify_input();
+
+        ea_t entry = func_entry(ea);
+        bool entered = false;
+        if (entry != cur_func)
+        {
+            if (entry != BADADDR)
+            {
+                // A warmed function whose snapshot was evicted or invalidated is a miss
+                bool was_warmed = warmed.erase(entry) != 0;
+                if (cache->has_snapshot(entry))
+                    st.hits += was_warmed ? 1 : 0;
+                else if (!cache->has_failed(entry))
+                    ++st.misses;
+            }
+
+            if (cur_func != BADADDR)
+            {
+                history.erase(std::remove(history.begin(), history.end(), cur_func), history.end());
+                history.push_back(cur_func);
+                if (history.size() > max_history)
+                    history.pop_front();
+            }
+            cur_func = entry;
+
+            // Predictions for the previous function are stale
+            clear_queue();
+            entered = true;
+        }
+
+        // Highest scoring sources first: collection stops at max_candidates
+        if ((sources & PFS_XREFS) != 0)
+            predict_xrefs(ea);
+        if (entered)
+        {
+            if (entry != BADADDR && (sources & PFS_CALLEES) != 0)
+                predict_callees(get_func(entry));
+            if ((sources & PFS_HISTORY) != 0)
+                predict_history();
+            if (entry != BADADDR && (sources & PFS_CALLERS) != 0)
+                predict_callers(entry);
+        }
+        finish_queue();
+    }
+
+    /**
+     * @brief Decompile queued candidates until the slice budget is spent.
+     *
+     * Input cannot be observed while the slice runs (UI notifications are
+     * delivered between timer callbacks), so `slice_ms` bounds the delay.
+     *
+     * @return Number of functions prefetched
+     */
+    size_t run_slice()
+    {
+        auto start = clock_t_::now();
+        auto budget = std::chrono::milliseconds(slice_ms);
+        size_t done = 0;
+
+        while (next < queue.size() && clock_t_::now() - start < budget)
+        {
+            ea_t ea = queue[next++].ea;
+            queued.erase(ea);
+
+            func_t* pfn = get_func(ea);
+            if (pfn == nullptr
+                || cache->get_snapshot(ea) != nullptr
+                || cache->has_failed(ea)
+                || calc_func_size(pfn) > max_func_size)
+            {
+                ++st.skipped;
+                continue;
+            }
+
+            cfuncptr_t cfunc = cache->get(pfn, decomp_flags);
+            if (cfunc == nullptr)
+            {
+                ++st.failed;
+                continue;
+            }
+            cache->put_snapshot(ea, make_snapshot(cfunc));
+            warmed.insert(ea);
+            trim_warmed();
+            ++st.prefetched;
+            ++done;
+        }
+
+        if (done != 0)
+            ++st.slices;
+        return done;
+    }
+
+    /// Number of queued candidates
+    size_t pending() const { return queue.size() - next; }
+
+    /// Counters
+    const prefetch_stats_t& stats() const { return st; }
+
+    /// Reset the counters
+    void reset_stats() { st = prefetch_stats_t(); }
+
+    /// The warmed cache
+    cfunc_cache_t& get_cache() { return *cache; }
+
+    /**
+     * @brief UI notification handler (navigation and input detection).
+     */
+    ssize_t idaapi on_event(ssize_t code, va_list va) override
+    {
+        switch (code)
+        {
+            case ui_screen_ea_changed:
+                on_navigate(va_arg(va, ea_t));
+                break;
+            case ui_preprocess_action:
+                notify_input();
+                break;
+            case ui_database_closed:
+                stop();
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,355 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Pseudocode line/column hit-test index
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <kernwin.hpp>
+#include <lines.hpp>
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Walk the COLOR_ADDR tags of a colored pseudocode line.
+ *
+ * Columns count the characters left after tag removal (as tag_remove() would
+ * produce), so they match the x coordinate of the pseudocode view.
+ *
+ * @param line Colored line
+ * @param cb Callback invoked as cb(column, anchor_value) for every COLOR_ADDR tag
+ * @return Visible length of the line
+ */
+template <typename F>
+uint32_t scan_addr_tags(const char* line, F cb)
+{
+    uint32_t col = 0;
+    const char* p = line;
+    while (*p != '\0')
+    {
+        switch (*p)
+        {
+            case COLOR_ON:
+                if (p[1] == COLOR_ADDR)
+                {
+                    uint64_t value = 0;
+                    const char* hex = p + 2;
+                    int n = 0;
+                    for (; n < COLOR_ADDR_SIZE && hex[n] != '\0'; ++n)
+                    {
+                        char c = hex[n];
+                        int digit = c >= '0' && c <= '9' ? c - '0'
+                                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                  : 0;
+                        value = (value << 4) | uint64_t(digit);
+                    }
+                    cb(col, uval_t(value));
+                    p = hex + n;
+                }
+                else
+                {
+                    p += p[1] != '\0' ? 2 : 1;
+                }
+                break;
+            case COLOR_OFF:
+                p += p[1] != '\0' ? 2 : 1;
+                break;
+            case COLOR_ESC:
+                // The escaped character is visible
+                if (p[1] != '\0')
+                {
+                    ++col;
+                    p += 2;
+                }
+                else
+                {
+                    ++p;
+                }
+                break;
+            case COLOR_INV:
+                ++p;
+                break;
+            default:
+                ++col;
+                ++p;
+                break;
+        }
+    }
+    return col;
+}
+
+/// Range of pseudocode lines, inclusive
+struct line_span_t
+{
+    int first = -1;
+    int last = -1;
+
+    bool valid() const { return first >= 0; }
+
+    void add(int line)
+    {
+        if (first < 0 || line < first)
+            first = line;
+        if (line > last)
+            last = line;
+    }
+
+    void add(const line_span_t& r)
+    {
+        if (r.valid())
+        {
+            add(r.first);
+            add(r.last);
+        }
+    }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Two-way index between pseudocode coordinates and ctree items.
+ *
+ * Built once per printed cfunc by scanning the COLOR_ADDR tags of
+ * cfunc_t::get_pseudocode(). A tag marks the start of the text that belongs to
+ * an anchor (item, lvar declaration, comment position), up to the next tag.
+ *
+ * - (line, column) -> anchor/item: binary search within the line, O(log n)
+ * - item -> line span: O(1) via citem_t::index, either the lines showing the
+ *   item's own tokens or the lines covered by its whole subtree
+ *
+ * Rebuild whenever the pseudocode is regenerated (refresh_view, hxe_text_ready).
+ *
+ * @example
+ * @code
+ * pseudocode_index_t index;
+ * index.build(vu.cfunc);
+ * if (auto item = index.item_at(vu.cpos.lnnum, vu.cpos.x))
+ *     msg("%a spans lines %d..%d\n", item->ea, index.lines_of(item).first, index.lines_of(item).last);
+ * @endcode
+ */
+class pseudocode_index_t
+{
+private:
+    cfunc_t* cfunc = nullptr;
+    std::vector<uint32_t> line_start;      ///< First segment of each line (size = line_count() + 1)
+    std::vector<uint32_t> seg_col;         ///< Start column of each segment
+    std::vector<uval_t> seg_anchor;        ///< Anchor value of each segment
+    std::vector<line_span_t> own_span;     ///< Lines showing the item's own tokens, by citem_t::index
+    std::vector<line_span_t> tree_span;    ///< Lines covered by the item's subtree, by citem_t::index
+
+    static bool is_item_anchor(uval_t value)
+    {
+        ctree_anchor_t a;
+        a.value = value;
+        return a.is_citem_anchor() && !a.is_blkcmt_anchor();
+    }
+
+    citem_t* anchor_item(uval_t value) const
+    {
+        if (!is_item_anchor(value))
+            return nullptr;
+        size_t idx = value & ANCHOR_INDEX;
+        return idx < cfunc->treeitems.size() ? cfunc->treeitems[idx] : nullptr;
+    }
+
+    void build_tree_spans()
+    {
+        tree_span = own_span;
+
+        // Pre-order list with parent positions, then a reverse sweep unions
+        // every subtree into its parent
+        struct node_t
+        {
+            citem_t* item;
+            size_t parent;
+        };
+        std::vector<node_t> nodes;
+        std::vector<size_t> stack;
+        std::vector<citem_t*> children;
+        nodes.push_back(node_t{&cfunc->body, SIZE_MAX});
+        stack.push_back(0);
+        while (!stack.empty())
+        {
+            size_t n = stack.back();
+            stack.pop_back();
+            children.clear();
+            for_each_child(nodes[n].item, [&children](citem_t* child) { children.push_back(child); });
+            for (auto p = children.rbegin(); p != children.rend(); ++p)
+            {
+                stack.push_back(nodes.size());
+                nodes.push_back(node_t{*p, n});
+            }
+        }
+
+        std::vector<line_span_t> spans(nodes.size());
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            int idx = nodes[i].item->index;
+            if (idx >= 0 && size_t(idx) < own_span.size())
+                spans[i].add(own_span[idx]);
+            if (idx >= 0 && size_t(idx) < tree_span.size())
+                tree_span[idx] = spans[i];
+            if (nodes[i].parent != SIZE_MAX)
+                spans[nodes[i].parent].add(spans[i]);
+        }
+    }
+
+public:
+    /**
+     * @brief Build the index from the function's current pseudocode.
+     *
+     * @param func Decompiled function (get_pseudocode() prints it if needed)
+     */
+    void build(cfunc_t* func)
+    {
+        build(func, func->get_pseudocode());
+    }
+
+    /**
+     * @brief Build the index from already generated pseudocode lines.
+     *
+     * @param func Decompiled function the lines were printed from
+     * @param lines Colored pseudocode lines
+     */
+    void build(cfunc_t* func, const strvec_t& lines)
+    {
+        clear();
+        cfunc = func;
+        own_span.resize(func->treeitems.size());
+
+        line_start.reserve(lines.size() + 1);
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            line_start.push_back(uint32_t(seg_col.size()));
+            scan_addr_tags(lines[i].line.c_str(), [&](uint32_t col, uval_t value)
+            {
+                seg_col.push_back(col);
+                seg_anchor.push_back(value);
+                if (is_item_anchor(value))
+                {
+                    size_t idx = value & ANCHOR_INDEX;
+                    if (idx < own_span.size())
+                        own_span[idx].add(int(i));
+                }
+            });
+        }
+        line_start.push_back(uint32_t(seg_col.size()));
+
+        build_tree_spans();
+    }
+
+    /**
+     * @brief Remove all entries.
+     */
+    void clear()
+    {
+        cfunc = nullptr;
+        line_start.clear();
+        seg_col.clear();
+        seg_anchor.clear();
+        own_span.clear();
+        tree_span.clear();
+    }
+
+    /// Number of indexed lines
+    size_t line_count() const { return line_start.empty() ? 0 : line_start.size() - 1; }
+
+    /**
+     * @brief Get the anchor covering a position.
+     *
+     * @param line Pseudocode line number
+     * @param col Visible column
+     * @param out Receives the anchor
+     * @return false if no tag precedes the position on that line
+     */
+    bool anchor_at(int line, int col, ctree_anchor_t* out) const
+    {
+        if (line < 0 || size_t(line) >= line_count())
+            return false;
+
+        auto first = seg_col.begin() + line_start[line];
+        auto last = seg_col.begin() + line_start[line + 1];
+        // The last tag at or before the column wins
+        auto p = std::upper_bound(first, last, uint32_t(std::max(col, 0)));
+        if (p == first)
+            return false;
+        out->value = seg_anchor[(p - seg_col.begin()) - 1];
+        return true;
+    }
+
+    /**
+     * @brief Get the ctree item at a position.
+     *
+     * @return Item, or nullptr if the position is not covered by an item anchor
+     */
+    citem_t* item_at(int line, int col) const
+    {
+        ctree_anchor_t a;
+        return anchor_at(line, col, &a) ? anchor_item(a.value) : nullptr;
+    }
+
+    /**
+     * @brief Get the lines spanned by an item.
+     *
+     * @param item Item of the indexed function
+     * @param subtree true for the lines covered by the whole subtree, false for
+     *        the lines showing the item's own tokens only
+     * @return Line span (invalid if the item is not printed)
+     */
+    line_span_t lines_of(const citem_t* item, bool subtree = true) const
+    {
+        auto& spans = subtree ? tree_span : own_span;
+        int idx = item->index;
+        return (idx >= 0 && size_t(idx) < spans.size()) ? spans[idx] : line_span_t();
+    }
+
+    /**
+     * @brief Get the distinct items tagged on a line, in column order.
+     *
+     * @param line Pseudocode line number
+     * @param out Output items
+     * @return Number of items
+     */
+    size_t items_on_line(int line, std::vector<citem_t*>& out) const
+    {
+        out.clear();
+        if (line < 0 || size_t(line) >= line_count())
+            return 0;
+        for (auto i = line_start[line]; i < line_start[line + 1]; ++i)
+        {
+            auto item = anchor_item(seg_anchor[i]);
+            if (item != nullptr && std::find(out.begin(), out.end(), item) == out.end())
+                out.push_back(item);
+        }
+        return out.size();
+    }
+
+    /**
+     * @brief Approximate heap memory used by the index, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return line_start.capacity() * sizeof(uint32_t)
+             + seg_col.capacity() * sizeof(uint32_t)
+             + seg_anchor.capacity() * sizeof(uval_t)
+             + (own_span.capacity() + tree_span.capacity()) * sizeof(line_span_t);
+    }
+
+    /// Heap bytes per indexed item
+    double bytes_per_node() const
+    {
+        return own_span.empty() ? 0.0 : double(memory_bytes()) / double(own_span.size());
+    }
+};
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,292 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Pull-based ctree traversal and ranges
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Every expression type
+inline ctype_set_t expr_ops()
+{
+    ctype_set_t ops;
+    for (int op = cot_empty; op <= cot_last; ++op)
+        ops.set(op);
+    return ops;
+}
+
+/// Every statement type
+inline ctype_set_t insn_ops()
+{
+    ctype_set_t ops;
+    for (int op = cit_empty; op < cit_end; ++op)
+        ops.set(op);
+    return ops;
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Suspendable pre-order ctree walker.
+ *
+ * Pull-based replacement for ctree_visitor_t: next() returns items one at a
+ * time from an explicit stack, with no virtual calls and no allocation once
+ * the stack has grown to the tree depth. The cursor keeps its position
+ * between calls, so a traversal can be spread over several UI ticks as long
+ * as the ctree is not modified in between.
+ *
+ * Items are produced in the canonical for_each_child() order, which is the
+ * order ctree_visitor_t uses.
+ *
+ * @example
+ * @code
+ * ctree_cursor_t cur(&cfunc->body);
+ * while (citem_t* item = cur.next())
+ * {
+ *     if (item->op == cit_if)
+ *         cur.skip_children();   // like prune_now()
+ *     if (out_of_time())
+ *         break;                 // resume later with cur.next()
+ * }
+ * @endcode
+ */
+class ctree_cursor_t
+{
+private:
+    struct entry_t
+    {
+        citem_t* item;
+        uint32_t depth;
+    };
+
+    std::vector<entry_t> stack;
+    ctype_set_t ops = ctype_set_t().set();
+    bool insns_only = false;
+    citem_t* cur = nullptr;
+    uint32_t cur_depth = 0;
+    bool skip = false;
+    bool finished = true;
+
+    /// Push the children of the last returned item, unless it was skipped
+    void expand()
+    {
+        if (cur == nullptr || skip)
+        {
+            skip = false;
+            return;
+        }
+
+        size_t first = stack.size();
+        uint32_t depth = cur_depth + 1;
+        bool only_insns = insns_only;
+        for_each_child(cur, [this, depth, only_insns](citem_t* child)
+        {
+            if (!(only_insns && child->is_expr()))
+                stack.push_back(entry_t{child, depth});
+        });
+        std::reverse(stack.begin() + first, stack.end());
+    }
+
+public:
+    ctree_cursor_t() = default;
+
+    /**
+     * @brief Start a traversal.
+     *
+     * @param root Root item
+     * @param ops Item types to return (others are walked through but not returned)
+     * @param insns_only Do not descend into expressions
+     */
+    explicit ctree_cursor_t(citem_t* root, const ctype_set_t& ops = ctype_set_t().set(), bool insns_only = false)
+        : ops(ops), insns_only(insns_only)
+    {
+        reset(root);
+    }
+
+    /**
+     * @brief Restart from a new root, keeping the stack storage.
+     */
+    void reset(citem_t* root)
+    {
+        stack.clear();
+        cur = nullptr;
+        skip = false;
+        finished = root == nullptr;
+        if (root != nullptr)
+            stack.push_back(entry_t{root, 0});
+    }
+
+    /**
+     * @brief Get the next item of a wanted type.
+     *
+     * @return Item, or nullptr once the traversal is complete
+     */
+    citem_t* next()
+    {
+        expand();
+        while (!stack.empty())
+        {
+            auto e = stack.back();
+            stack.pop_back();
+            cur = e.item;
+            cur_depth = e.depth;
+            if (ops.test(cur->op))
+                return cur;
+            expand();
+        }
+        cur = nullptr;
+        finished = true;
+        return nullptr;
+    }
+
+    /**
+     * @brief Do not descend into the item last returned by next().
+     */
+    void skip_children() { skip = true; }
+
+    /// Item last returned by next()
+    citem_t* current() const { return cur; }
+
+    /// Depth of the current item below the root (0 for the root)
+    uint32_t depth() const { return cur_depth; }
+
+    /// true once next() returned nullptr
+    bool done() const { return finished; }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Input range over a ctree, usable with range-for and std::views.
+ *
+ * Iterating the same range object again continues where the previous loop
+ * stopped, which makes time-sliced processing a plain `break`.
+ *
+ * @tparam T citem_t, cexpr_t or cinsn_t
+ */
+template <typename T>
+class ctree_range_t : public std::ranges::view_interface<ctree_range_t<T>>
+{
+private:
+    ctree_cursor_t cursor;
+
+public:
+    class iterator
+    {
+        ctree_cursor_t* cur = nullptr;
+        T* item = nullptr;
+
+    public:
+        using value_type = T*;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(ctree_cursor_t* cur, T* item) : cur(cur), item(item) {}
+
+        T* operator*() const { return item; }
+
+        iterator& operator++()
+        {
+            item = (T*)cur->next();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.item == nullptr; }
+    };
+
+    ctree_range_t() = default;
+
+    /**
+     * @param root Root item
+     * @param ops Item types to produce
+     * @param insns_only Do not descend into expressions
+     */
+    ctree_range_t(citem_t* root, const ctype_set_t& ops, bool insns_only = false)
+        : cursor(root, ops, insns_only) {}
+
+    /// Resume the traversal at the next item
+    iterator begin() { return iterator(&cursor, (T*)cursor.next()); }
+
+    std::default_sentinel_t end() const { return {}; }
+
+    /// Do not descend into the item last produced
+    void skip_children() { cursor.skip_children(); }
+
+    /// true once every item was produced
+    bool done() const { return cursor.done(); }
+
+    /// Underlying cursor
+    ctree_cursor_t& get_cursor() { return cursor; }
+};
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Range over the expressions of a function.
+ *
+ * @example
+ * @code
+ * for (cexpr_t* e : exprs(cfunc) | std::views::filter(op_is(cot_call)))
+ *     msg("call at %a\n", e->ea);
+ * @endcode
+ *
+ * @param cfunc Decompiled function
+ * @param ops Expression types to produce (default: all); filtering here is
+ *        cheaper than a std::views::filter stage
+ */
+inline ctree_range_t<cexpr_t> exprs(cfunc_t* cfunc, const ctype_set_t& ops = expr_ops())
+{
+    return ctree_range_t<cexpr_t>(&cfunc->body, ops & expr_ops());
+}
+
+/**
+ * @brief Range over the expressions of a subtree.
+ */
+inline ctree_range_t<cexpr_t> exprs(citem_t* root, const ctype_set_t& ops = expr_ops())
+{
+    return ctree_range_t<cexpr_t>(root, ops & expr_ops());
+}
+
+/**
+ * @brief Range over the statements of a function (expressions are not entered).
+ */
+inline ctree_range_t<cinsn_t> insns(cfunc_t* cfunc, const ctype_set_t& ops = insn_ops())
+{
+    return ctree_range_t<cinsn_t>(&cfunc->body, ops & insn_ops(), true);
+}
+
+/**
+ * @brief Range over every item of a function.
+ */
+inline ctree_range_t<citem_t> all_items(cfunc_t* cfunc, const ctype_set_t& ops = ctype_set_t().set())
+{
+    return ctree_range_t<citem_t>(&cfunc->body, ops);
+}
+
+/// Predicate matching one item type, for std::views::filter
+inline auto op_is(ctype_t op)
+{
+    return [op](const citem_t* item) { return item->op == op; };
+}
+
+/// Predicate matching a set of item types, for std::views::filter
+inline auto op_in(const ctype_set_t& ops)
+{
+    return [ops](const citem_t* item) { return ops.test(item->op); };
+}
+
+}  // namespace idacpp::hexrays
@@ -0,0 +1,470 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Vectorized scans over ctree snapshot columns
+*/
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+
+// Define IDACPP_NO_SIMD to force the scalar kernels
+#if !defined(IDACPP_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+    #define IDACPP_SIMD_X86 1
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+    #include <immintrin.h>
+#elif !defined(IDACPP_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+    #define IDACPP_SIMD_NEON 1
+    #include <arm_neon.h>
+#endif
+
+// Compile a function for an instruction set not enabled globally
+#if defined(__GNUC__) || defined(__clang__)
+    #define IDACPP_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define IDACPP_TARGET(isa)
+#endif
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/// Instruction set used by the scan kernels
+enum simd_level_t
+{
+    SIMD_SCALAR,   ///< Portable fallback
+    SIMD_SSE42,    ///< x86 SSSE3 byte shuffles and SSE4.2 64-bit compares
+    SIMD_AVX2,     ///< x86 AVX2
+    SIMD_NEON,     ///< ARMv8 Advanced SIMD
+};
+
+/**
+ * @brief Detect the best instruction set supported by the running CPU.
+ */
+inline simd_level_t detect_simd_level()
+{
+#if defined(IDACPP_SIMD_X86)
+    #if defined(_MSC_VER)
+        int r[4];
+        __cpuid(r, 0);
+        int max_leaf = r[0];
+        __cpuid(r, 1);
+        bool sse42 = (r[2] & (1 << 20)) != 0 && (r[2] & (1 << 9)) != 0;
+        bool osxsave = (r[2] & (1 << 27)) != 0;
+        bool avx2 = false;
+        if (max_leaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(r, 7, 0);
+            avx2 = (r[1] & (1 << 5)) != 0;
+        }
+    #else
+        __builtin_cpu_init();
+        bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("ssse3");
+        bool avx2 = __builtin_cpu_supports("avx2");
+    #endif
+    return avx2 ? SIMD_AVX2 : sse42 ? SIMD_SSE42 : SIMD_SCALAR;
+#elif defined(IDACPP_SIMD_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+/**
+ * @brief Get the instruction set used by the scans.
+ *
+ * Detected once; set_simd_level() may lower it (e.g. to compare kernels).
+ */
+inline simd_level_t& active_simd_level()
+{
+    static simd_level_t level = detect_simd_level();
+    return level;
+}
+
+/**
+ * @brief Select the instruction set used by the scans.
+ *
+ * @param level Requested level; ignored if the CPU does not support it
+ * @return The level now in use
+ */
+inline simd_level_t set_simd_level(simd_level_t level)
+{
+    simd_level_t best = detect_simd_level();
+    bool ok = level == SIMD_SCALAR
+           || level == best
+           || (level == SIMD_SSE42 && best == SIMD_AVX2);
+    if (ok)
+        active_simd_level() = level;
+    return active_simd_level();
+}
+
+/// Name of an instruction set level
+inline const char* simd_level_name(simd_level_t level)
+{
+    switch (level)
+    {
+        case SIMD_SSE42: return "sse4.2";
+        case SIMD_AVX2:  return "avx2";
+        case SIMD_NEON:  return "neon";
+        default:         return "scalar";
+    }
+}
+
+//----------------------------------------------------------------------------------
+namespace scan_detail
+{
+    /// Nibble lookup tables for byte set membership (item types are < 128)
+    struct op_tables_t
+    {
+        alignas(16) uint8_t lo[16] = {};   ///< Low nibble -> bit set of matching high nibbles
+        alignas(16) uint8_t hi[16] = {};   ///< High nibble -> its bit
+        bool member[256] = {};             ///< Scalar lookup
+    };
+
+    inline op_tables_t make_op_tables(const ctype_set_t& ops)
+    {
+        op_tables_t t;
+        for (size_t op = 0; op < ops.size() && op < 128; ++op)
+        {
+            if (!ops.test(op))
+                continue;
+            t.lo[op & 15] |= uint8_t(1u << (op >> 4));
+            t.member[op] = true;
+        }
+        for (int h = 0; h < 8; ++h)
+            t.hi[h] = uint8_t(1u << h);
+        return t;
+    }
+
+    /// Append base + position of every set bit
+    inline void emit_mask(std::vector<node_id_t>& out, size_t base, uint64_t mask)
+    {
+        if (mask == 0)
+            return;
+        size_t k = out.size();
+        out.resize(k + size_t(std::popcount(mask)));
+        node_id_t* w = out.data() + k;
+        while (mask != 0)
+        {
+            *w++ = node_id_t(base + size_t(std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    inline void scan_ops_scalar(const uint8_t* op, size_t first, size_t last, const op_tables_t& t, std::vector<node_id_t>& out)
+    {
+        for (size_t i = first; i < last; ++i)
+            if (t.member[op[i]])
+                out.push_back(node_id_t(i));
+    }
+
+    inline void scan_ea_scalar(const ea_t* ea, size_t first, size_t last, ea_t lo, ea_t hi, std::vector<node_id_t>& out)
+    {
+        for (size_t i = first; i < last; ++i)
+            if (ea[i] >= lo && ea[i] < hi)
+                out.push_back(node_id_t(i));
+    }
+
+#if defined(IDACPP_SIMD_X86)
+    IDACPP_TARGET("avx2")
+    inline void scan_ops_avx2(const uint8_t* op, size_t first, size_t last, const op_tables_t& t, std::vector<node_id_t>& out)
+    {
+        const __m256i lo_tbl = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.lo));
+        const __m256i hi_tbl = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.hi));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+
+        size_t i = first;
+        for (; i + 64 <= last; i += 64)
+        {
+            uint64_t mask = 0;
+            for (int half = 0; half < 2; ++half)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(op + i + half * 32));
+                __m256i l = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(v, nibble));
+                __m256i h = _mm256_shuffle_epi8(hi_tbl, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+                __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero);
+                mask |= uint64_t(uint32_t(~_mm256_movemask_epi8(miss))) << (half * 32);
+            }
+            emit_mask(out, i, mask);
+        }
+        scan_ops_scalar(op, i, last, t, out);
+    }
+
+    IDACPP_TARGET("ssse3,sse4.2")
+    inline void scan_ops_sse42(const uint8_t* op, size_t first, size_t last, const op_tables_t& t, std::vector<node_id_t>& out)
+    {
+        const __m128i lo_tbl = _mm_load_si128((const __m128i*)t.lo);
+        const __m128i hi_tbl = _mm_load_si128((const __m128i*)t.hi);
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t i = first;
+        for (; i + 64 <= last; i += 64)
+        {
+            uint64_t mask = 0;
+            for (int q = 0; q < 4; ++q)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(op + i + q * 16));
+                __m128i l = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(v, nibble));
+                __m128i h = _mm_shuffle_epi8(hi_tbl, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+                __m128i miss = _mm_cmpeq_epi8(_mm_and_si128(l, h), zero);
+                mask |= uint64_t(uint16_t(~_mm_movemask_epi8(miss))) << (q * 16);
+            }
+            emit_mask(out, i, mask);
+        }
+        scan_ops_scalar(op, i, last, t, out);
+    }
+
+    IDACPP_TARGET("avx2")
+    inline void scan_ea_avx2(const ea_t* ea, size_t first, size_t last, ea_t lo, ea_t hi, std::vector<node_id_t>& out)
+    {
+        if constexpr (sizeof(ea_t) != 8)
+        {
+            scan_ea_scalar(ea, first, last, lo, hi, out);
+        }
+        else
+        {
+            // Unsigned compares through a sign flip
+            const __m256i flip = _mm256_set1_epi64x(INT64_MIN);
+            const __m256i vlo = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(lo)), flip);
+            const __m256i vhi = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(hi)), flip);
+
+            size_t i = first;
+            for (; i + 64 <= last; i += 64)
+            {
+                uint64_t mask = 0;
+                for (int q = 0; q < 16; ++q)
+                {
+                    __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(ea + i + q * 4)), flip);
+                    __m256i below = _mm256_cmpgt_epi64(vlo, v);   // ea < lo
+                    __m256i under = _mm256_cmpgt_epi64(vhi, v);   // ea < hi
+                    __m256i in = _mm256_andnot_si256(below, under);
+                    mask |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(in))) << (q * 4);
+                }
+                emit_mask(out, i, mask);
+            }
+            scan_ea_scalar(ea, i, last, lo, hi, out);
+        }
+    }
+
+    IDACPP_TARGET("sse4.2")
+    inline void scan_ea_sse42(const ea_t* ea, size_t first, size_t last, ea_t lo, ea_t hi, std::vector<node_id_t>& out)
+    {
+        if constexpr (sizeof(ea_t) != 8)
+        {
+            scan_ea_scalar(ea, first, last, lo, hi, out);
+        }
+        else
+        {
+            const __m128i flip = _mm_set1_epi64x(INT64_MIN);
+            const __m128i vlo = _mm_xor_si128(_mm_set1_epi64x(int64_t(lo)), flip);
+            const __m128i vhi = _mm_xor_si128(_mm_set1_epi64x(int64_t(hi)), flip);
+
+            size_t i = first;
+            for (; i + 64 <= last; i += 64)
+            {
+                uint64_t mask = 0;
+                for (int q = 0; q < 32; ++q)
+                {
+                    __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(ea + i + q * 2)), flip);
+                    __m128i in = _mm_andnot_si128(_mm_cmpgt_epi64(vlo, v), _mm_cmpgt_epi64(vhi, v));
+                    mask |= uint64_t(_mm_movemask_pd(_mm_castsi128_pd(in))) << (q * 2);
+                }
+                emit_mask(out, i, mask);
+            }
+            scan_ea_scalar(ea, i, last, lo, hi, out);
+        }
+    }
+#endif
+
+#if defined(IDACPP_SIMD_NEON)
+    /// Compress a byte mask (0x00/0xFF lanes) into one bit per lane
+    inline uint16_t neon_movemask(uint8x16_t m)
+    {
+        static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        uint8x16_t b = vandq_u8(m, vld1q_u8(bits));
+        return uint16_t(vaddv_u8(vget_low_u8(b)) | (vaddv_u8(vget_high_u8(b)) << 8));
+    }
+
+    inline void scan_ops_neon(const uint8_t* op, size_t first, size_t last, const op_tables_t& t, std::vector<node_id_t>& out)
+    {
+        const uint8x16_t lo_tbl = vld1q_u8(t.lo);
+        const uint8x16_t hi_tbl = vld1q_u8(t.hi);
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+
+        size_t i = first;
+        for (; i + 64 <= last; i += 64)
+        {
+            uint64_t mask = 0;
+            for (int q = 0; q < 4; ++q)
+            {
+                uint8x16_t v = vld1q_u8(op + i + q * 16);
+                uint8x16_t l = vqtbl1q_u8(lo_tbl, vandq_u8(v, nibble));
+                uint8x16_t h = vqtbl1q_u8(hi_tbl, vshrq_n_u8(v, 4));
+                uint8x16_t hit = vtstq_u8(l, h);
+                mask |= uint64_t(neon_movemask(hit)) << (q * 16);
+            }
+            emit_mask(out, i, mask);
+        }
+        scan_ops_scalar(op, i, last, t, out);
+    }
+
+    inline void scan_ea_neon(const ea_t* ea, size_t first, size_t last, ea_t lo, ea_t hi, std::vector<node_id_t>& out)
+    {
+        if constexpr (sizeof(ea_t) != 8)
+        {
+            scan_ea_scalar(ea, first, last, lo, hi, out);
+        }
+        else
+        {
+            const uint64x2_t vlo = vdupq_n_u64(uint64_t(lo));
+            const uint64x2_t vhi = vdupq_n_u64(uint64_t(hi));
+
+            size_t i = first;
+            for (; i + 64 <= last; i += 64)
+            {
+                uint64_t mask = 0;
+                for (int q = 0; q < 32; ++q)
+                {
+                    uint64x2_t v = vld1q_u64((const uint64_t*)(ea + i + q * 2));
+                    uint64x2_t in = vandq_u64(vcgeq_u64(v, vlo), vcltq_u64(v, vhi));
+                    mask |= ((vgetq_lane_u64(in, 0) & 1) | ((vgetq_lane_u64(in, 1) & 1) << 1)) << (q * 2);
+                }
+                emit_mask(out, i, mask);
+            }
+            scan_ea_scalar(ea, i, last, lo, hi, out);
+        }
+    }
+#endif
+
+    /// Clamp [first, last) to a column of n elements
+    inline void clamp_range(size_t n, node_id_t& first, node_id_t& last)
+    {
+        if (last == BAD_NODE_ID || last > n)
+            last = node_id_t(n);
+        if (first > last)
+            first = last;
+    }
+}  // namespace scan_detail
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Find the nodes whose item type is in a set.
+ *
+ * Scans the `op` column 64 nodes at a time using the active instruction set
+ * (byte set membership through two nibble table lookups, so the set size does
+ * not matter).
+ *
+ * @example
+ * @code
+ * ctype_set_t calls;
+ * calls.set(cot_call);
+ * std::vector<node_id_t> hits;
+ * scan_ops(snap, calls, hits);
+ * // only inside one statement:
+ * scan_ops(snap, calls, hits, stmt, snap.end[stmt]);
+ * @endcode
+ *
+ * @param snap Snapshot
+ * @param ops Wanted item types
+ * @param out Output node ids, ascending (cleared first)
+ * @param first First node to scan
+ * @param last One past the last node to scan (BAD_NODE_ID for the end)
+ * @return Number of nodes found
+ */
+inline size_t scan_ops(
+    const ctree_snapshot_t& snap,
+    const ctype_set_t& ops,
+    std::vector<node_id_t>& out,
+    node_id_t first = 0,
+    node_id_t last = BAD_NODE_ID)
+{
+    out.clear();
+    scan_detail::clamp_range(snap.size(), first, last);
+    auto t = scan_detail::make_op_tables(ops);
+    const uint8_t* op = snap.op.data();
+
+    switch (active_simd_level())
+    {
+#if defined(IDACPP_SIMD_X86)
+        case SIMD_AVX2:  scan_detail::scan_ops_avx2(op, first, last, t, out); break;
+        case SIMD_SSE42: scan_detail::scan_ops_sse42(op, first, last, t, out); break;
+#endif
+#if defined(IDACPP_SIMD_NEON)
+        case SIMD_NEON:  scan_detail::scan_ops_neon(op, first, last, t, out); break;
+#endif
+        default:         scan_detail::scan_ops_scalar(op, first, last, t, out); break;
+    }
+    return out.size();
+}
+
+/**
+ * @brief Find the nodes whose address lies in [start, end).
+ *
+ * @param snap Snapshot
+ * @param start First address
+ * @param end One past the last address
+ * @param out Output node ids, ascending (cleared first)
+ * @param first First node to scan
+ * @param last One past the last node to scan (BAD_NODE_ID for the end)
+ * @return Number of nodes found
+ */
+inline size_t scan_ea_range(
+    const ctree_snapshot_t& snap,
+    ea_t start,
+    ea_t end,
+    std::vector<node_id_t>& out,
+    node_id_t first = 0,
+    node_id_t last = BAD_NODE_ID)
+{
+    out.clear();
+    scan_detail::clamp_range(snap.size(), first, last);
+    const ea_t* ea = snap.ea.data();
+
+    switch (active_simd_level())
+    {
+#if defined(IDACPP_SIMD_X86)
+        case SIMD_AVX2:  scan_detail::scan_ea_avx2(ea, first, last, start, end, out); break;
+        case SIMD_SSE42: scan_detail::scan_ea_sse42(ea, first, last, start, end, out); break;
+#endif
+#if defined(IDACPP_SIMD_NEON)
+        case SIMD_NEON:  scan_detail::scan_ea_neon(ea, first, last, start, end, out); break;
+#endif
+        default:         scan_detail::scan_ea_scalar(ea, first, last, start, end, out); break;
+    }
+    return out.size();
+}
+
+/**
+ * @brief Keep only the nodes (from a previous scan) whose address lies in [start, end).
+ *
+ * Combines both scans: run the more selective one first, then filter.
+ *
+ * @param snap Snapshot
+ * @param start First address
+ * @param end One past the last address
+ * @param nodes In/out node list
+ * @return Number of nodes kept
+ */
+inline size_t filter_ea_range(const ctree_snapshot_t& snap, ea_t start, ea_t end, std::vector<node_id_t>& nodes)
+{
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&](node_id_t n)
+    {
+        return snap.ea[n] < start || snap.ea[n] >= end;
+    }), nodes.end());
+    return nodes.size();
+}
+
+}  // namespace idacpp::hexrays
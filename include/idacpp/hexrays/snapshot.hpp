@@ -0,0 +1,254 @@
+/*
+idacpp - Modern C++ extensions for IDA SDK
+Copyright (c) 2025 Elias Bachaalany <elias.bachaalany@gmail.com>
+
+Hexrays utilities module - Flattened ctree snapshots
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <hexrays.hpp>
+
+#include <idacpp/hexrays/hexrays.hpp>
+
+namespace idacpp::hexrays
+{
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Compute the op-specific payload stored in a snapshot node.
+ *
+ * - cot_num: numeric value
+ * - cot_obj: object address
+ * - cot_var: local variable index
+ * - cot_memref/cot_memptr: member offset
+ * - cot_call: argument count
+ * - cot_ptr: access size
+ * - cot_str/cot_helper: hash of the string
+ * - cit_goto: target label number
+ *
+ * Every other node type has a zero payload.
+ *
+ * @param item Tree item
+ * @return Payload value
+ */
+inline uint64_t snapshot_aux(const citem_t* item)
+{
+    if (item->is_expr())
+    {
+        auto e = (const cexpr_t*)item;
+        switch (e->op)
+        {
+            case cot_num:     return e->numval();
+            case cot_obj:     return e->obj_ea;
+            case cot_var:     return uint64_t(e->v.idx);
+            case cot_memref:
+            case cot_memptr:  return e->m;
+            case cot_call:    return e->a->size();
+            case cot_ptr:     return uint64_t(e->ptrsize);
+            case cot_str:     return hash_cstr(e->string);
+            case cot_helper:  return hash_cstr(e->helper);
+            default:          return 0;
+        }
+    }
+
+    auto ins = (const cinsn_t*)item;
+    return ins->op == cit_goto ? uint64_t(ins->cgoto->label_num) : 0;
+}
+
+//----------------------------------------------------------------------------------
+/**
+ * @brief Flattened, column-oriented copy of a ctree.
+ *
+ * Nodes are stored in pre-order, so the subtree of node i occupies the
+ * contiguous range [i, end[i]). Every column is indexed by node_id_t.
+ *
+ * The live item pointers in `items` are only valid while the source cfunc_t
+ * is alive; call detach() before keeping a snapshot past that point. All other
+ * columns are pointer-free and can be cached, compared or persisted.
+ *
+ * @example
+ * @code
+ * ctree_snapshot_t snap;
+ * snap.build(cfunc);
+ * for (node_id_t i = 0; i < snap.size(); ++i)
+ *     if (snap.op[i] == cot_call)
+ *         msg("call at %a with %llu args\n", snap.ea[i], snap.aux[i]);
+ * @endcode
+ */
+class ctree_snapshot_t
+{
+public:
+    ea_t func_ea = BADADDR;           ///< Entry address of the source function
+    std::vector<uint8_t> op;          ///< Item type (ctype_t)
+    std::vector<ea_t> ea;             ///< Item address
+    std::vector<node_id_t> parent;    ///< Parent node, or BAD_NODE_ID for the root
+    std::vector<node_id_t> end;       ///< One past the last node of the subtree
+    std::vector<uint64_t> aux;        ///< Op-specific payload (see snapshot_aux)
+    std::vector<citem_t*> items;      ///< Live item pointers (empty once detached)
+    ctype_set_t ops;                  ///< Every item type present in the tree
+
+    /**
+     * @brief Build the snapshot from a decompiled function body.
+     *
+     * @param cfunc Decompiled function
+     * @param keep_items Record live item pointers
+     */
+    void build(cfunc_t* cfunc, bool keep_items = true)
+    {
+        build(&cfunc->body, cfunc->entry_ea, keep_items);
+    }
+
+    /**
+     * @brief Build the snapshot from an arbitrary subtree.
+     *
+     * @param root Root item
+     * @param entry_ea Function entry address to record
+     * @param keep_items Record live item pointers
+     */
+    void build(citem_t* root, ea_t entry_ea, bool keep_items = true)
+    {
+        clear();
+        func_ea = entry_ea;
+
+        struct pending_t
+        {
+            citem_t* item;
+            node_id_t parent;
+        };
+        std::vector<pending_t> stack{{root, BAD_NODE_ID}};
+        std::vector<citem_t*> children;
+
+        while (!stack.empty())
+        {
+            auto [item, par] = stack.back();
+            stack.pop_back();
+
+            auto id = node_id_t(op.size());
+            op.push_back(uint8_t(item->op));
+            ea.push_back(item->ea);
+            parent.push_back(par);
+            end.push_back(id + 1);
+            aux.push_back(snapshot_aux(item));
+            if (keep_items)
+                items.push_back(item);
+            ops.set(item->op);
+
+            children.clear();
+            for_each_child(item, [&children](citem_t* child) { children.push_back(child); });
+            for (auto p = children.rbegin(); p != children.rend(); ++p)
+                stack.push_back(pending_t{*p, id});
+        }
+
+        // Children always follow their parent in pre-order, so a reverse sweep
+        // sees every subtree end before it is propagated to the parent.
+        for (size_t i = op.size(); i-- > 1;)
+            end[parent[i]] = std::max(end[parent[i]], end[i]);
+    }
+
+    /**
+     * @brief Drop the live item pointers.
+     */
+    void detach()
+    {
+        items.clear();
+        items.shrink_to_fit();
+    }
+
+    /**
+     * @brief Remove all nodes.
+     */
+    void clear()
+    {
+        func_ea = BADADDR;
+        op.clear();
+        ea.clear();
+        parent.clear();
+        end.clear();
+        aux.clear();
+        items.clear();
+        ops.reset();
+    }
+
+    /// Number of nodes
+    size_t size() const { return op.size(); }
+
+    /// true if the snapshot has no nodes
+    bool empty() const { return op.empty(); }
+
+    /// true if live item pointers are available
+    bool has_items() const { return !items.empty(); }
+
+    /// Item type of a node
+    ctype_t op_of(node_id_t n) const { return ctype_t(op[n]); }
+
+    /**
+     * @brief Check if node a is a proper ancestor of node b in O(1).
+     */
+    bool is_ancestor_of(node_id_t a, node_id_t b) const
+    {
+        return a < b && b < end[a];
+    }
+
+    /**
+     * @brief Get the first child of a node.
+     *
+     * @return Child node, or BAD_NODE_ID if the node is a leaf
+     */
+    node_id_t first_child(node_id_t n) const
+    {
+        return n + 1 < end[n] ? n + 1 : BAD_NODE_ID;
+    }
+
+    /**
+     * @brief Get the next sibling of a node.
+     *
+     * @return Sibling node, or BAD_NODE_ID if n is the last child
+     */
+    node_id_t next_sibling(node_id_t n) const
+    {
+        auto p = parent[n];
+        return (p != BAD_NODE_ID && end[n] < end[p]) ? end[n] : BAD_NODE_ID;
+    }
+
+    /**
+     * @brief Approximate heap memory used by the snapshot, in bytes.
+     */
+    size_t memory_bytes() const
+    {
+        return op.capacity() * sizeof(uint8_t)
+             + ea.capacity() * sizeof(ea_t)
+             + parent.capacity() * sizeof(node_id_t)
+             + end.capacity() * sizeof(node_id_t)
+             + aux.capacity() * sizeof(uint64_t)
+             + items.capacity() * sizeof(citem_t*);
+    }
+
+    /// Heap bytes per node
+    double bytes_per_node() const
+    {
+        return op.empty() ? 0.0 : double(memory_bytes()) / double(op.size());
+    }
+};
+
+/// Shared, immutable snapshot
+using ctree_snapshot_ptr_t = std::shared_ptr<const ctree_snapshot_t>;
+
+/**
+ * @brief Build a pointer-free snapshot of a decompiled function.
+ *
+ * @param cfunc Decompiled function
+ * @return Detached snapshot
+ */
+inline ctree_snapshot_ptr_t make_snapshot(cfunc_t* cfunc)
+{
+    auto snap = std::make_shared<ctree_snapshot_t>();
+    snap->build(cfunc, false);
+    return snap;
+}
+
+}  // namespace idacpp::hexrays
@@ -14,9 +14,29 @@ Master convenience header - includes all idacpp modules
 
 // Hexrays utilities (decompiler)
 #include <idacpp/hexrays/hexrays.hpp>
+#include <idacpp/hexrays/snapshot.hpp>
+#include <idacpp/hexrays/batch.hpp>
+#include <idacpp/hexrays/hash.hpp>
+#include <idacpp/hexrays/microcode.hpp>
+#include <idacpp/hexrays/multiplex.hpp>
+#include <idacpp/hexrays/lvars.hpp>
+#include <idacpp/hexrays/pseudocode.hpp>
+#include <idacpp/hexrays/callgraph.hpp>
+#include <idacpp/hexrays/prefetch.hpp>
+#include <idacpp/hexrays/ranges.hpp>
+#include <idacpp/hexrays/scan.hpp>
+#include <idacpp/hexrays/diff.hpp>
+#include <idacpp/hexrays/metrics.hpp>
+#include <idacpp/hexrays/annotations.hpp>
+#include <idacpp/hexrays/ids.hpp>
+#include <idacpp/hexrays/cfg.hpp>
 
 // Expression utilities
 #include <idacpp/expr/expr.hpp>
+#include <idacpp/expr/cache.hpp>
+#include <idacpp/expr/batch.hpp>
+#include <idacpp/expr/native.hpp>
+#include <idacpp/expr/pybridge.hpp>
 
 // Callback utilities
 #include <idacpp/callbacks/callbacks.hpp>